@@ -23,6 +23,11 @@ int main(int argc, char **argv)
    
     // if the application is already running, notify it.
     if( app.isRunning() ) {
+        if( app.planOnly() ) {
+            // the running instance holds the journals of all folders.
+            qWarning( "Can not plan the sync while the client is running." );
+            return -1;
+        }
         QStringList args = app.arguments();
         if ( args.size() > 1 && ! app.giveHelp() ) {
             QString msg = args.join( QLatin1String("|") );
@@ -31,6 +36,9 @@ int main(int argc, char **argv)
         }
         return 0;
     }
+    if( app.lockedOut() ) {
+        return -1;
+    }
     // if help requested, show on command line and exit.
     if( ! app.giveHelp() ) {
         return app.exec();
@@ -72,6 +72,8 @@ static const char optionsC[] =
         "  --logflush           : flush the log file after every write.\n"
         "  --monoicons          : Use black/white pictograms for systray.\n"
         "  --confdir <dirname>  : Use the given configuration directory.\n"
+        "  --plan               : print what a sync of every folder would\n"
+        "                         transfer and quit, nothing is synced.\n"
         ;
 
 QString applicationTrPath()
@@ -106,6 +108,8 @@ Application::Application(int &argc, char **argv) :
     _showLogWindow(false),
     _logFlush(false),
     _helpOnly(false),
+    _planOnly(false),
+    _lockedOut(false),
     _fileItemDialog(0),
     _statusDialog(0),
     _folderWizard(0)
@@ -119,6 +123,12 @@ Application::Application(int &argc, char **argv) :
     //no need to waste time;
     if ( _helpOnly ) return;
 
+    // a second client only hands its arguments to the first one.
+    if( !isRunning() && !lockConfiguration() ) {
+        _lockedOut = true;
+        return;
+    }
+
     connect( this, SIGNAL(messageReceived(QString)), SLOT(slotParseOptions(QString)));
     connect( Logger::instance(), SIGNAL(guiLog(QString,QString)),
              this, SLOT(slotShowTrayMessage(QString,QString)));
@@ -144,6 +154,8 @@ Application::Application(int &argc, char **argv) :
              SLOT(slotEnableFolder(QString,bool)));
     connect( _statusDialog, SIGNAL(infoFolderAlias(const QString&)),
              SLOT(slotInfoFolder( const QString&)));
+    connect( _statusDialog, SIGNAL(planFolderAlias(const QString&)),
+             SLOT(slotPlanFolder( const QString&)));
     connect( _statusDialog, SIGNAL(openFolderAlias(const QString&)),
              SLOT(slotFolderOpenAction(QString)));
 
@@ -365,8 +377,23 @@ void Application::slotAuthCheck( const QString& ,QNetworkReply *reply )
             _tray->showMessage(tr("%1 Sync Started").arg(_theme->appNameGUI()),
                                tr("Sync started for %1 configured sync folder(s).").arg(cnt));
 
-        // queue up the sync for all folders.
-        _folderMan->slotScheduleAllFolders();
+        if( _planOnly ) {
+            // every run only plans, also the ones triggered by the watchers.
+            _folderMan->setPlanOnly(true);
+            foreach( Folder *f, _folderMan->map() ) {
+                if( f->syncEnabled() && f->syncResult().status() != SyncResult::SetupError ) {
+                    _pendingPlans.insert( f->alias() );
+                    f->slotRequestPlan();
+                }
+            }
+            if( _pendingPlans.isEmpty() ) {
+                std::cout << qPrintable(tr("No sync folders to plan.")) << std::endl;
+                quit();
+            }
+        } else {
+            // queue up the sync for all folders.
+            _folderMan->slotScheduleAllFolders();
+        }
 
         computeOverallSyncStatus();
 
@@ -827,6 +854,16 @@ void Application::slotInfoFolder( const QString& alias )
     raiseDialog( _fileItemDialog );
 }
 
+void Application::slotPlanFolder( const QString& alias )
+{
+    qDebug() << "plan sync of folder with alias " << alias;
+
+    Folder *f = _folderMan->folder( alias );
+    if( f ) {
+        f->slotRequestPlan();
+    }
+}
+
 void Application::slotEnableFolder(const QString& alias, const bool enable)
 {
     qDebug() << "Application: enable folder with alias " << alias;
@@ -908,6 +945,43 @@ void Application::slotSyncStateChange( const QString& alias )
     if (result.status() == SyncResult::Success || result.status() == SyncResult::Error) {
         enterNextLogFile();
     }
+
+    if( _planOnly && _pendingPlans.contains(alias) ) {
+        printPlan( alias, result );
+    }
+}
+
+void Application::printPlan( const QString& alias, const SyncResult& result )
+{
+    QStringList lines;
+
+    switch( result.status() ) {
+    case SyncResult::Planned:
+        lines = result.plan().summary();
+        break;
+    case SyncResult::Error:
+    case SyncResult::SetupError:
+    case SyncResult::Unavailable:
+        lines = result.errorStrings();
+        if( lines.isEmpty() ) {
+            lines << result.statusString();
+        }
+        break;
+    default:
+        // not finished yet.
+        return;
+    }
+
+    std::cout << qPrintable(tr("Folder %1:").arg(alias)) << std::endl;
+    foreach( const QString& line, lines ) {
+        std::cout << "  " << qPrintable(line) << std::endl;
+    }
+    std::cout << std::endl;
+
+    _pendingPlans.remove( alias );
+    if( _pendingPlans.isEmpty() ) {
+        quit();
+    }
 }
 
 void Application::parseOptions(const QStringList &options)
@@ -945,6 +1019,8 @@ void Application::parseOptions(const QStringList &options)
             }
         } else if (option == QLatin1String("--logflush")) {
             _logFlush = true;
+        } else if (option == QLatin1String("--plan")) {
+            _planOnly = true;
         } else if (option == QLatin1String("--monoicons")) {
             _theme->setSystrayUseMonoIcons(true); 
         } else if (option == QLatin1String("--confdir")) {
@@ -1005,6 +1081,20 @@ void Application::computeOverallSyncStatus()
             }
             folderMessage = tr( "Last Sync was successful." );
             break;
+        case SyncResult::Deferred:
+            if( overallResult.status() == SyncResult::Undefined ) {
+                overallResult.setStatus( SyncResult::Success );
+            }
+            folderMessage = tr( "%1 MB to transfer, deferred until %2." )
+                    .arg( folderResult.deferredBytes() / (1024*1024) )
+                    .arg( folderResult.deferredUntil().toString( QLatin1String("hh:mm") ) );
+            break;
+        case SyncResult::Planned:
+            if( overallResult.status() == SyncResult::Undefined ) {
+                overallResult.setStatus( SyncResult::Success );
+            }
+            folderMessage = tr( "Sync plan ready." );
+            break;
         case SyncResult::Error:
             overallResult.setStatus( SyncResult::Error );
             folderMessage = tr( "Syncing Error." );
@@ -1187,6 +1277,45 @@ void Application::setupTranslations()
     }
 }
 
+bool Application::planOnly() const
+{
+    return _planOnly;
+}
+
+/*
+ * owncloudd takes the same lock, only one of them may sync the folders of
+ * a configuration.
+ */
+bool Application::lockConfiguration()
+{
+    MirallConfigFile cfg;
+    QDir().mkpath( cfg.configPath() );
+    _instanceLock.setFileName( cfg.instanceLockFile() );
+    if( !_instanceLock.open( QIODevice::ReadWrite ) ) {
+        qDebug() << "WRN: Can not open the instance lock" << _instanceLock.fileName();
+        return true;
+    }
+    if( !_instanceLock.lock( SharedTools::QtLockedFile::WriteLock, false ) ) {
+        QString owner = QString::fromUtf8( _instanceLock.readAll() ).trimmed();
+        qDebug() << "The configuration is in use by" << owner;
+        QMessageBox::critical( 0, tr("%1 is already running").arg(_theme->appNameGUI()),
+                               tr("<p>The sync folders of this configuration are synced by "
+                                  "another process (%1).</p><p>Stop it first, for example with "
+                                  "<tt>owncloudd --control quit</tt>.</p>").arg(owner) );
+        return false;
+    }
+    _instanceLock.resize(0);
+    _instanceLock.write( QString::fromLatin1("%1 %2\n").arg( applicationName() )
+                         .arg( applicationPid() ).toUtf8() );
+    _instanceLock.flush();
+    return true;
+}
+
+bool Application::lockedOut() const
+{
+    return _lockedOut;
+}
+
 bool Application::giveHelp()
 {
     return _helpOnly;
@@ -18,8 +18,10 @@
 #include <QApplication>
 #include <QNetworkReply>
 #include <QSslError>
+#include <QSet>
 
 #include "qtsingleapplication.h"
+#include "qtlockedfile.h"
 
 #include "mirall/syncresult.h"
 #include "mirall/folder.h"
@@ -53,7 +55,10 @@ public:
     ~Application();
 
     bool giveHelp();
+    bool planOnly() const;
     void showHelp();
+    // true if owncloudd syncs this configuration, the client has to quit
+    bool lockedOut() const;
 
 signals:
 
@@ -63,6 +68,7 @@ protected slots:
     void slotRemoveFolder( const QString& );
     void slotEnableFolder( const QString&, const bool );
     void slotInfoFolder( const QString& );
+    void slotPlanFolder( const QString& );
     void slotConfigure();
     void slotConfigureProxy();
     void slotParseOptions( const QString& );
@@ -80,10 +86,14 @@ protected:
     void setupLogBrowser();
     void setupProxy();
     void enterNextLogFile();
+    bool lockConfiguration();
 
     //folders have to be disabled while making config changes
     void computeOverallSyncStatus();
 
+    // prints the plan of a folder in --plan mode and quits after the last one
+    void printPlan( const QString&, const SyncResult& );
+
     // reimplemented
 #if defined(Q_WS_WIN)
     bool winEventFilter( MSG * message, long * result );
@@ -143,6 +153,10 @@ private:
     bool _showLogWindow;
     bool _logFlush;
     bool _helpOnly;
+    bool _planOnly;
+    bool _lockedOut;
+    QSet<QString> _pendingPlans;
+    SharedTools::QtLockedFile _instanceLock;
 };
 
 } // namespace Mirall
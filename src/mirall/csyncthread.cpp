@@ -13,10 +13,13 @@
  * for more details.
  */
 
+#include "config.h"
+
 #include "mirall/csyncthread.h"
 #include "mirall/mirallconfigfile.h"
 #include "mirall/theme.h"
 #include "mirall/logger.h"
+#include "mirall/memoryusage.h"
 #include "mirall/owncloudinfo.h"
 
 #ifdef Q_OS_WIN
@@ -26,16 +29,18 @@
 #endif
 
 #include <assert.h>
+#include <string.h>
 
 #include <QDebug>
 #include <QSslSocket>
 #include <QDir>
+#include <QFileInfo>
 #include <QMutexLocker>
 #include <QThread>
 #include <QStringList>
 #include <QTextStream>
 #include <QTime>
-#include <QApplication>
+#include <QCoreApplication>
 #include <QUrl>
 #include <QSslCertificate>
 
@@ -47,17 +52,44 @@ QMutex CSyncThread::_mutex;
 QMutex CSyncThread::_syncMutex;
 
 CSyncThread::CSyncThread(CSYNC *csync)
+    : _bulkTransferLimit(0),
+      _planOnly(false),
+      _treeNodes(0),
+      _treePathBytes(0)
 {
     _mutex.lock();
     _csync_ctx = csync;
     _mutex.unlock();
 }
 
+void CSyncThread::setLocalPath( const QString& path )
+{
+    QMutexLocker locker(&_mutex);
+    _localPath = path;
+}
+
+void CSyncThread::setBulkTransferLimit( qint64 bytes )
+{
+    QMutexLocker locker(&_mutex);
+    _bulkTransferLimit = bytes;
+}
+
+void CSyncThread::setPlanOnly( bool planOnly )
+{
+    QMutexLocker locker(&_mutex);
+    _planOnly = planOnly;
+}
+
 CSyncThread::~CSyncThread()
 {
 
 }
 
+QMutex *CSyncThread::syncMutex()
+{
+    return &_syncMutex;
+}
+
 //Convert an error code from csync to a user readable string.
 // Keep that function thread safe as it can be called from the sync thread or the main thread
 QString CSyncThread::csyncErrorToString( CSYNC_ERROR_CODE err, const char *errString )
@@ -182,6 +214,9 @@ int CSyncThread::walkFinalize(TREE_WALK_FILE* file, void *data )
 int CSyncThread::treewalkFile( TREE_WALK_FILE *file, bool remote )
 {
     if( ! file ) return -1;
+    _treeNodes++;
+    _treePathBytes += strlen( file->path );
+
     SyncFileItem item;
     item._file = QString::fromUtf8( file->path );
     item._instruction = file->instruction;
@@ -233,7 +268,35 @@ int CSyncThread::treewalkFile( TREE_WALK_FILE *file, bool remote )
     }
 
     item._dir = dir;
+
+    switch(file->instruction) {
+    case CSYNC_INSTRUCTION_CONFLICT:
+        // both trees report the conflict, the remote version is downloaded.
+        if( !remote ) break;
+        // fall through
+    case CSYNC_INSTRUCTION_NEW:
+    case CSYNC_INSTRUCTION_SYNC:
+#ifdef HAVE_TREE_WALK_FILE_SIZE
+        item._size = file->size;
+#else
+        // the tree walk of this csync version does not carry the size,
+        // it is only known for local files.
+        if( !remote && !_localPath.isEmpty() ) {
+            QFileInfo fi( _localPath + QLatin1Char('/') + item._file );
+            if( fi.isFile() ) {
+                item._size = fi.size();
+            }
+        }
+#endif
+        break;
+    default:
+        break;
+    }
+
     _mutex.lock();
+    if( !_syncedItemIndex.contains(item._file) ) {
+        _syncedItemIndex.insert(item._file, _syncedItems.count());
+    }
     _syncedItems.append(item);
     _mutex.unlock();
 
@@ -242,9 +305,11 @@ int CSyncThread::treewalkFile( TREE_WALK_FILE *file, bool remote )
 
 int CSyncThread::treewalkError(TREE_WALK_FILE* file)
 {
-    SyncFileItem item;
-    item._file= QString::fromUtf8(file->path);
-    int indx = _syncedItems.indexOf(item);
+    if( !file ) return 0;
+
+    // the finalize walk visits every file, for large removes or renames a
+    // linear search in _syncedItems per file does not scale.
+    int indx = _syncedItemIndex.value(QString::fromUtf8(file->path), -1);
 
     if ( indx == -1 )
         return 0;
@@ -267,7 +332,11 @@ struct CSyncRunScopeHelper {
         _t.start();
     }
     ~CSyncRunScopeHelper() {
+        QTime commitTime;
+        commitTime.start();
         csync_commit(_ctx);
+        emit(_parent->phaseTime(QLatin1String("commit"), commitTime.elapsed()));
+        emit(_parent->transferProgress(_parent->_transferredFiles, _parent->_uploadedBytes, _parent->_downloadedBytes));
 
         qDebug() << "CSync run took " << _t.elapsed() << " Milliseconds";
         emit(_parent->finished());
@@ -309,9 +378,17 @@ void CSyncThread::startSync()
 
     _mutex.lock();
     _syncedItems.clear();
+    _syncedItemIndex.clear();
     _needsUpdate = false;
     _mutex.unlock();
 
+    _transferredFiles = 0;
+    _uploadedBytes = 0;
+    _downloadedBytes = 0;
+    _currentFileBytes = 0;
+    _treeNodes = 0;
+    _treePathBytes = 0;
+
     // cleans up behind us and emits finished() to ease error handling
     CSyncRunScopeHelper helper(_csync_ctx, this);
 
@@ -321,17 +398,22 @@ void CSyncThread::startSync()
     // csync_set_auth_callback( _csync_ctx, getauth );
     csync_set_progress_callback( _csync_ctx, progress );
 
+    QTime phaseTimer;
+    phaseTimer.start();
+
     qDebug() << "#### Update start #################################################### >>";
     if( csync_update(_csync_ctx) < 0 ) {
         handleSyncError(_csync_ctx, "csync_update");
         return;
     }
     qDebug() << "<<#### Update end ###########################################################";
+    emit phaseTime(QLatin1String("update"), phaseTimer.restart());
 
     if( csync_reconcile(_csync_ctx) < 0 ) {
         handleSyncError(_csync_ctx, "cysnc_reconcile");
         return;
     }
+    emit phaseTime(QLatin1String("reconcile"), phaseTimer.restart());
 
     _hasFiles = false;
     bool walkOk = true;
@@ -343,6 +425,12 @@ void CSyncThread::startSync()
         qDebug() << "Error in remote treewalk.";
     }
 
+    if( _planOnly ) {
+        qDebug() << Q_FUNC_INFO << "Plan only, stopping before propagation";
+        emit treeWalkResult(_syncedItems);
+        return;
+    }
+
     if (!_hasFiles && !_syncedItems.isEmpty()) {
         qDebug() << Q_FUNC_INFO << "All the files are going to be removed, asking the user";
         bool cancel = true;
@@ -353,13 +441,27 @@ void CSyncThread::startSync()
         }
     }
 
+    if( _bulkTransferLimit > 0 ) {
+        qint64 planned = plannedTransferSize();
+        if( planned > _bulkTransferLimit ) {
+            qDebug() << Q_FUNC_INFO << "Run would transfer" << planned << "bytes, more than"
+                     << _bulkTransferLimit << "allowed outside the transfer window. Deferred.";
+            // the items were not propagated, the folder keeps the ones
+            // of its last real run.
+            emit transferDeferred(planned);
+            return;
+        }
+    }
+
     if (_needsUpdate)
         emit(started());
 
+    phaseTimer.restart();
     if( csync_propagate(_csync_ctx) < 0 ) {
         handleSyncError(_csync_ctx, "cysnc_reconcile");
         return;
     }
+    emit phaseTime(QLatin1String("propagate"), phaseTimer.elapsed());
 
     if( walkOk ) {
         if( csync_walk_local_tree(_csync_ctx, &walkFinalize, 0) < 0 ||
@@ -373,14 +475,71 @@ void CSyncThread::startSync()
     qDebug() << Q_FUNC_INFO << "Sync finished";
 }
 
+QHash<QString, qint64> CSyncThread::memoryUsage( const SyncFileItemVector& reported ) const
+{
+    QHash<QString, qint64> usage;
+    QMutexLocker locker( &_mutex );
+    // a queued treeWalkResult() shares the vector until the next run clears it
+    bool shared = !_syncedItems.isEmpty() && _syncedItems.constData() == reported.constData();
+    usage.insert( QLatin1String("csyncThreadItems"), shared ? 0 : MemoryUsage::itemVectorBytes( _syncedItems ) );
+    usage.insert( QLatin1String("csyncThreadIndex"), MemoryUsage::itemIndexBytes( _syncedItemIndex ) );
+    // the trees are freed by csync_commit, that is the peak of the run
+    usage.insert( QLatin1String("csyncTreesPeak"), MemoryUsage::csyncTreeBytes( _treeNodes, _treePathBytes ) );
+    return usage;
+}
+
+int CSyncThread::syncedItemCount() const
+{
+    QMutexLocker locker( &_mutex );
+    return _syncedItems.count();
+}
+
+// sum of the known sizes of all files the run would transfer
+qint64 CSyncThread::plannedTransferSize() const
+{
+    qint64 bytes = 0;
+    foreach( const SyncFileItem& item, _syncedItems ) {
+        if( item._size > 0 ) {
+            bytes += item._size;
+        }
+    }
+    return bytes;
+}
+
+void CSyncThread::transmissionFinished( bool upload )
+{
+    _transferredFiles++;
+    if( upload ) {
+        _uploadedBytes += _currentFileBytes;
+    } else {
+        _downloadedBytes += _currentFileBytes;
+    }
+    _currentFileBytes = 0;
+}
+
 void CSyncThread::progress(const char *remote_url, enum csync_notify_type_e kind,
                                         long long o1, long long o2, void *userdata)
 {
-    (void) o1; (void) o2;
-    if (kind == CSYNC_NOTIFY_FINISHED_DOWNLOAD) {
-        QString path = QUrl::fromEncoded(remote_url).toString();
-        CSyncThread *thread = static_cast<CSyncThread*>(userdata);
-        thread->fileReceived(path);
+    CSyncThread *thread = static_cast<CSyncThread*>(userdata);
+
+    switch( kind ) {
+    case CSYNC_NOTIFY_START_DOWNLOAD:
+    case CSYNC_NOTIFY_START_UPLOAD:
+        thread->_currentFileBytes = 0;
+        break;
+    case CSYNC_NOTIFY_PROGRESS:
+        // o1 is the amount of bytes transferred, o2 the file size
+        thread->_currentFileBytes = qMax( o1, o2 );
+        break;
+    case CSYNC_NOTIFY_FINISHED_DOWNLOAD:
+        thread->transmissionFinished(false);
+        thread->fileReceived(QUrl::fromEncoded(remote_url).toString());
+        break;
+    case CSYNC_NOTIFY_FINISHED_UPLOAD:
+        thread->transmissionFinished(true);
+        break;
+    default:
+        break;
     }
 }
 
@@ -21,6 +21,7 @@
 #include <QMutex>
 #include <QThread>
 #include <QString>
+#include <QHash>
 #include <QNetworkProxy>
 
 #include <csync.h>
@@ -40,8 +41,40 @@ public:
 
     static QString csyncErrorToString( CSYNC_ERROR_CODE, const char * );
 
+    /**
+     * Held while a sync runs. The owncloud module keeps one network session
+     * for all contexts, so creating and initializing a context has to hold
+     * it as well.
+     */
+    static QMutex *syncMutex();
+
     Q_INVOKABLE void startSync();
 
+    // the local sync directory, used to look up upload sizes.
+    void setLocalPath( const QString& );
+
+    /**
+     * If the files the run would transfer add up to more than this amount
+     * of bytes, propagation is skipped and only transferDeferred() is
+     * emitted, not treeWalkResult().
+     * 0 means no limit. Set before startSync() is invoked.
+     */
+    void setBulkTransferLimit( qint64 bytes );
+
+    /**
+     * In plan-only mode the run stops after reconcile and the tree walks,
+     * nothing is transferred. treeWalkResult() reports what would be done.
+     */
+    void setPlanOnly( bool );
+
+    /**
+     * Approximate bytes held by the items of the last run, their index
+     * and, while the run was in the tree walks, the csync trees. Items
+     * that share their data with reported, usually the vector handed
+     * out by treeWalkResult(), are not counted again.
+     */
+    QHash<QString, qint64> memoryUsage( const SyncFileItemVector& reported ) const;
+
 signals:
     void fileReceived( const QString& );
     void fileRemoved( const QString& );
@@ -51,13 +84,24 @@ signals:
     void treeWalkResult(const SyncFileItemVector&);
 
     void csyncStateDbFile( const QString& );
+    // duration of one csync phase of the current run
+    void phaseTime( const QString& phase, int msec );
+    // files and bytes transferred by the run, emitted once when it ends.
+    void transferProgress( int files, qint64 uploadedBytes, qint64 downloadedBytes );
     void wipeDb();
+    // the run was stopped before propagation because it exceeds the bulk limit
+    void transferDeferred( qint64 plannedBytes );
 
     void finished();
     void started();
 
     void aboutToRemoveAllFiles(SyncFileItem::Direction direction, bool *cancel);
 
+protected:
+    // one step of the local or remote tree walk, adds the file to the items
+    int treewalkFile( TREE_WALK_FILE*, bool );
+    int syncedItemCount() const;
+
 private:
     void handleSyncError(CSYNC *ctx, const char *state);
     static void progress(const char *remote_url,
@@ -67,8 +111,9 @@ private:
 
     static int treewalkLocal( TREE_WALK_FILE*, void *);
     static int treewalkRemote( TREE_WALK_FILE*, void *);
-    int treewalkFile( TREE_WALK_FILE*, bool );
     int treewalkError( TREE_WALK_FILE* );
+    void transmissionFinished( bool upload );
+    qint64 plannedTransferSize() const;
 
     static int walkFinalize(TREE_WALK_FILE*, void* );
 
@@ -77,12 +122,28 @@ private:
     static QMutex _mutex;
     static QMutex _syncMutex;
     SyncFileItemVector _syncedItems;
+    // position of every item in _syncedItems, keyed by path
+    QHash<QString, int> _syncedItemIndex;
 
     CSYNC *_csync_ctx;
     bool _needsUpdate;
 
     bool _hasFiles; // true if there is at least one file that is not ignored or removed
 
+    QString _localPath;
+    qint64 _bulkTransferLimit;
+    bool _planOnly;
+
+    // transfer accounting, only touched from the csync thread.
+    int    _transferredFiles;
+    qint64 _uploadedBytes;
+    qint64 _downloadedBytes;
+    qint64 _currentFileBytes;
+
+    // nodes and path bytes the tree walks visited, for memoryUsage()
+    int    _treeNodes;
+    qint64 _treePathBytes;
+
     friend class CSyncRunScopeHelper;
 };
 }
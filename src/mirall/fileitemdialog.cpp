@@ -86,6 +86,14 @@ void FileItemDialog::setSyncResult( const SyncResult& result )
     case SyncResult::SetupError:
         folderMessage = tr( "Setup Error." );
         break;
+    case SyncResult::Deferred:
+        folderMessage = tr( "%1 MB to transfer, deferred until %2." )
+                .arg( result.deferredBytes() / (1024*1024) )
+                .arg( result.deferredUntil().toString( QLatin1String("hh:mm") ) );
+        break;
+    case SyncResult::Planned:
+        folderMessage = tr( "Sync plan ready, no files were transferred." );
+        break;
     default:
         folderMessage = tr( "Undefined Error State." );
     }
@@ -93,7 +101,16 @@ void FileItemDialog::setSyncResult( const SyncResult& result )
     _folderMessage = folderMessage;
     _lastSyncTime = result.syncTime();
 
-    if( result.errorStrings().count() ) {
+    if( syncStatus == SyncResult::Planned ) {
+        // the item list still shows the last real sync, the plan goes here.
+        _errorLabel->setVisible(true);
+        _errorLabel->setTextFormat(Qt::RichText);
+        QString planStr;
+        foreach( const QString& line, result.plan().summary() ) {
+            planStr.append(QString("<p>%1</p>").arg(Qt::escape(line)));
+        }
+        _errorLabel->setText(planStr);
+    } else if( result.errorStrings().count() ) {
         _errorLabel->setVisible(true);
         _errorLabel->setTextFormat(Qt::RichText);
         QString errStr;
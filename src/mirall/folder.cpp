@@ -24,6 +24,12 @@
 #include <QFileSystemWatcher>
 #include <QDir>
 
+/* the poll interval grows up to this multiple of the configured one */
+#define MAX_POLL_BACKOFF_FACTOR 16
+
+/* the poll intervals of the folders differ by up to twice this */
+#define POLL_JITTER_MSEC 2000
+
 namespace Mirall {
 
 Folder::Folder(const QString &alias, const QString &path, const QString& secondPath, QObject *parent)
@@ -36,19 +42,30 @@ Folder::Folder(const QString &alias, const QString &path, const QString& secondP
       _onlyOnlineEnabled(false),
       _onlyThisLANEnabled(false),
       _online(false),
-      _enabled(true)
+      _enabled(true),
+      _syncReason(Poll),
+      _priorityWeight(1.0),
+      _basePollInterval(0),
+      _bulkWindowTimer(new QTimer(this)),
+      _bulkTransferThreshold(0),
+      _planRequested(false)
 {
     qsrand(QTime::currentTime().msec());
     MirallConfigFile cfgFile;
 
     _pollTimer->setSingleShot(true);
-    int polltime = cfgFile.remotePollInterval()- 2000 + (int)( 4000.0*qrand()/(RAND_MAX+1.0));
+    int polltime = jitteredPollInterval( cfgFile.remotePollInterval(), qrand()/(RAND_MAX+1.0) );
     qDebug() << "setting remote poll timer interval to" << polltime << "msec for folder " << alias;
     _pollTimer->setInterval( polltime );
+    _basePollInterval = polltime;
 
     QObject::connect(_pollTimer, SIGNAL(timeout()), this, SLOT(slotPollTimerTimeout()));
     _pollTimer->start();
 
+    // replaces the poll while a deferred run waits for the transfer window
+    _bulkWindowTimer->setSingleShot(true);
+    QObject::connect(_bulkWindowTimer, SIGNAL(timeout()), this, SLOT(slotPollTimerTimeout()));
+
     _watcher = new Mirall::FolderWatcher(path, this);
 
     MirallConfigFile cfg;
@@ -148,16 +165,19 @@ void Folder::setSyncEnabled( bool doit )
 {
   _enabled = doit;
   _watcher->setEventsEnabled( doit );
-  if( doit && ! _pollTimer->isActive() ) {
+  if( doit && ! _pollTimer->isActive() && ! _bulkWindowTimer->isActive() ) {
       _pollTimer->start();
   }
+  if( !doit ) {
+      _bulkWindowTimer->stop();
+  }
 
   qDebug() << "setSyncEnabled - ############################ " << doit;
   if( doit ) {
       // undefined until next sync
       _syncResult.setStatus( SyncResult::NotYetStarted);
       _syncResult.clearErrors();
-      evaluateSync( QStringList() );
+      evaluateSync( QStringList(), LocalChange );
   } else {
       // disable folder. Done through the _enabled-flag set above
   }
@@ -196,6 +216,7 @@ void Folder::setSyncState(SyncResult::Status state)
 void Folder::setPollInterval(int milliseconds)
 {
     _pollTimer->setInterval( milliseconds );
+    _basePollInterval = milliseconds;
 }
 
 int Folder::errorCount()
@@ -210,24 +231,102 @@ void Folder::resetErrorCount()
 
 void Folder::incrementErrorCount()
 {
-  // if the error count gets higher than three, the interval timer
-  // of the watcher is doubled.
-  _errorCount++;
-  if( _errorCount > 1 ) {
-    int interval = _watcher->eventInterval();
-    int newInt = 2*interval;
+  int interval = _watcher->eventInterval();
+  int newInt = nextEventInterval( &_errorCount, interval );
+  if( newInt != interval ) {
     qDebug() << "Set new watcher interval to " << newInt;
     _watcher->setEventInterval( newInt );
-    _errorCount = 0;
   }
 }
 
+int Folder::nextEventInterval( int *errorCount, int eventInterval )
+{
+  // if the error count gets higher than one, the interval timer
+  // of the watcher is doubled.
+  (*errorCount)++;
+  if( *errorCount > 1 ) {
+    *errorCount = 0;
+    return 2*eventInterval;
+  }
+  return eventInterval;
+}
+
+int Folder::jitteredPollInterval( int configured, double random )
+{
+  return configured - POLL_JITTER_MSEC + (int)( 2*POLL_JITTER_MSEC*random );
+}
+
 SyncResult Folder::syncResult() const
 {
   return _syncResult;
 }
 
-void Folder::evaluateSync(const QStringList &pathList)
+Folder::SyncReason Folder::syncReason() const
+{
+    return _syncReason;
+}
+
+void Folder::setPriorityWeight( double weight )
+{
+    if( weight > 0.0 ) {
+        _priorityWeight = weight;
+    }
+}
+
+double Folder::priorityWeight() const
+{
+    return _priorityWeight;
+}
+
+void Folder::setBulkTransferWindow( qint64 thresholdBytes, const QTime& start, const QTime& end )
+{
+    if( thresholdBytes > 0 && (!start.isValid() || !end.isValid()) ) {
+        qDebug() << "WRN: invalid transfer window for" << alias() << ", large transfers are not deferred.";
+        thresholdBytes = 0;
+    }
+    _bulkTransferThreshold = qMax( qint64(0), thresholdBytes );
+    _bulkWindowStart = start;
+    _bulkWindowEnd = end;
+}
+
+QTime Folder::bulkTransferWindowStart() const
+{
+    return _bulkWindowStart;
+}
+
+qint64 Folder::bulkTransferLimit() const
+{
+    if( _bulkTransferThreshold == 0 || _bulkWindowStart == _bulkWindowEnd ) return 0;
+
+    QTime now = QTime::currentTime();
+    bool inWindow;
+    if( _bulkWindowStart < _bulkWindowEnd ) {
+        inWindow = now >= _bulkWindowStart && now < _bulkWindowEnd;
+    } else {
+        // spans midnight
+        inWindow = now >= _bulkWindowStart || now < _bulkWindowEnd;
+    }
+    return inWindow ? 0 : _bulkTransferThreshold;
+}
+
+void Folder::setPlanRequested( bool plan )
+{
+    _planRequested = plan;
+}
+
+bool Folder::planRequested() const
+{
+    return _planRequested;
+}
+
+void Folder::slotRequestPlan()
+{
+    qDebug() << "* Plan requested for" << alias();
+    _planRequested = true;
+    evaluateSync(QStringList(), LocalChange);
+}
+
+void Folder::evaluateSync(const QStringList &pathList, SyncReason reason)
 {
   if( !_enabled ) {
     qDebug() << "*" << alias() << "sync skipped, disabled!";
@@ -242,8 +341,10 @@ void Folder::evaluateSync(const QStringList &pathList)
   // sync finished.
   qDebug() << "* " << alias() << "Poll timer disabled";
   _pollTimer->stop();
+  _bulkWindowTimer->stop();
 
   _syncResult.setStatus( SyncResult::NotYetStarted );
+  _syncReason = reason;
   emit scheduleToSync( alias() );
 
 }
@@ -252,7 +353,19 @@ void Folder::slotPollTimerTimeout()
 {
     qDebug() << "* Polling" << alias() << "for changes. Ignoring all pending events until now";
     _watcher->clearPendingEvents();
-    evaluateSync(QStringList());
+
+    // if the last run succeeded and brought changes from the server, the
+    // remote side is active and the poll is likely to find more.
+    SyncReason reason = Poll;
+    if( _syncResult.status() == SyncResult::Success ) {
+        foreach( const SyncFileItem& item, _syncResult.syncFileItemVector() ) {
+            if( item._dir == SyncFileItem::Down && item._instruction != CSYNC_INSTRUCTION_ERROR ) {
+                reason = RemoteChange;
+                break;
+            }
+        }
+    }
+    evaluateSync(QStringList(), reason);
 }
 
 void Folder::slotOnlineChanged(bool online)
@@ -264,7 +377,7 @@ void Folder::slotOnlineChanged(bool online)
 void Folder::slotChanged(const QStringList &pathList)
 {
     qDebug() << "** Changed was notified on " << pathList;
-    evaluateSync(pathList);
+    evaluateSync(pathList, LocalChange);
 }
 
 void Folder::slotSyncStarted()
@@ -275,14 +388,23 @@ void Folder::slotSyncStarted()
 
 void Folder::slotSyncFinished(const SyncResult &result)
 {
-    _watcher->setEventsEnabledDelayed(2000);
+    _watcher->setEventsEnabledDelayed(WATCHER_REENABLE_DELAY_MSEC);
 
     qDebug() << "OO folder slotSyncFinished: result: " << int(result.status());
     emit syncStateChange();
 
     // reenable the poll timer if folder is sync enabled
-    if( syncEnabled() ) {
+    if( syncEnabled() && result.status() == SyncResult::Deferred ) {
+        // polling before the window opens would only defer again.
+        int msec = QTime::currentTime().msecsTo( bulkTransferWindowStart() );
+        if( msec < 0 ) msec += 24*60*60*1000;
+        qDebug() << "* " << alias() << "Poll timer suspended, next check when the transfer window opens in"
+                 << msec << "milliseconds";
+        _pollTimer->stop();
+        _bulkWindowTimer->start( msec );
+    } else if( syncEnabled() ) {
         qDebug() << "* " << alias() << "Poll timer enabled with " << _pollTimer->interval() << "milliseconds";
+        _bulkWindowTimer->stop();
         _pollTimer->start();
     } else {
         qDebug() << "* Not enabling poll timer for " << alias();
@@ -290,6 +412,49 @@ void Folder::slotSyncFinished(const SyncResult &result)
     }
 }
 
+/*
+ * The poll interval follows the AIMD scheme known from TCP congestion
+ * control: it is doubled after every failed run, e.g. a network timeout,
+ * and lowered by the configured interval after every successful run until
+ * it is back at the configured value.
+ */
+void Folder::adjustPollInterval()
+{
+    const SyncResult& result = _syncResult;
+    int interval = nextPollInterval( _pollTimer->interval(), _basePollInterval, result.status() );
+    QString reason;
+
+    if( result.status() == SyncResult::Error || result.status() == SyncResult::Unavailable ) {
+        reason = tr("Backing off after a failed sync run.");
+    } else if( result.status() == SyncResult::Success ) {
+        if( interval > _basePollInterval ) {
+            reason = tr("Recovering from earlier failures.");
+        } else {
+            reason = tr("Configured poll interval.");
+        }
+    } else {
+        return;
+    }
+
+    _pollTimer->setInterval( interval );
+    _syncResult.setPollInterval( interval, reason );
+
+    qDebug() << "* Sync stats for" << alias() << ":" << result.transferredFiles() << "files,"
+             << result.uploadedBytes() << "bytes up at" << result.uploadRate() << "bytes/sec,"
+             << result.downloadedBytes() << "bytes down at" << result.downloadRate() << "bytes/sec;"
+             << "next poll in" << interval << "msec:" << reason;
+}
+
+int Folder::nextPollInterval( int current, int base, SyncResult::Status status )
+{
+    if( status == SyncResult::Error || status == SyncResult::Unavailable ) {
+        return qMin( 2*current, MAX_POLL_BACKOFF_FACTOR*base );
+    } else if( status == SyncResult::Success ) {
+        return qMax( base, current - base );
+    }
+    return current;
+}
+
 void Folder::slotLocalPathChanged( const QString& dir )
 {
     QDir notifiedDir(dir);
@@ -21,6 +21,7 @@
 #include <QStringList>
 #include <QHash>
 #include <QTimer>
+#include <QTime>
 
 #if QT_VERSION >= 0x040700
 #include <QNetworkConfigurationManager>
@@ -32,6 +33,9 @@ class QAction;
 class QIcon;
 class QFileSystemWatcher;
 
+/* delay after a sync run before the watcher reports events again */
+#define WATCHER_REENABLE_DELAY_MSEC 2000
+
 namespace Mirall {
 
 class FolderWatcher;
@@ -47,6 +51,15 @@ public:
     typedef QHash<QString, Folder*> Map;
     typedef QHashIterator<QString, Folder*> MapIterator;
 
+    /**
+     * Why a folder asked to be synced. Higher values are more urgent.
+     */
+    enum SyncReason {
+        Poll = 0,
+        RemoteChange,
+        LocalChange
+    };
+
     /**
      * alias or nickname
      */
@@ -148,6 +161,52 @@ public:
      QIcon icon( int size ) const;
      QTimer   *_pollTimer;
 
+     /**
+      * reason of the most recent sync request, read by the scheduler.
+      */
+     SyncReason syncReason() const;
+
+     /**
+      * relative scheduling weight from the folder config, default 1.0.
+      * A higher weight makes a waiting folder age faster in the queue.
+      */
+     void setPriorityWeight( double );
+     double priorityWeight() const;
+
+     /**
+      * Runs which would transfer more than thresholdBytes only start
+      * between start and end, local time. The window may span midnight.
+      * A threshold of 0 disables it.
+      */
+     void setBulkTransferWindow( qint64 thresholdBytes, const QTime& start, const QTime& end );
+     QTime bulkTransferWindowStart() const;
+
+     /**
+      * the planned transfer size above which a run has to be deferred
+      * right now, 0 if the window is open or not configured.
+      */
+     qint64 bulkTransferLimit() const;
+
+     /**
+      * if set, the next run only plans the sync and transfers nothing.
+      * The result is available as SyncResult::plan().
+      */
+     void setPlanRequested( bool );
+     bool planRequested() const;
+
+     /**
+      * The timing rules of a folder without the timers, so that the
+      * scheduling simulator can replay them on a virtual clock.
+      *
+      * jitteredPollInterval() moves the configured interval by up to two
+      * seconds, random is in [0, 1). nextPollInterval() is the poll interval
+      * after a run with the given status. nextEventInterval() counts an
+      * error and returns the new watcher interval.
+      */
+     static int jitteredPollInterval( int configured, double random );
+     static int nextPollInterval( int current, int base, SyncResult::Status );
+     static int nextEventInterval( int *errorCount, int eventInterval );
+
 signals:
     void syncStateChange();
     void syncStarted();
@@ -178,6 +237,17 @@ public slots:
       */
      virtual void setProxy() {}
 
+     /**
+      * If folder is network-based, reimplement to pass the transfer
+      * settings like bandwidth limits to the sync before it starts.
+      */
+     virtual void setTransferOptions() {}
+
+     /**
+      * schedules a plan-only run of this folder
+      */
+     void slotRequestPlan();
+
 protected:
     /**
      * The minimum amounts of seconds to wait before
@@ -186,6 +256,12 @@ protected:
     int pollInterval() const;
     void setSyncState(SyncResult::Status state);
 
+    /**
+     * Adapts the poll interval to the status of the finished run and
+     * stores it in the sync result. Call before syncFinished is emitted.
+     */
+    void adjustPollInterval();
+
     FolderWatcher *_watcher;
     int _errorCount;
     SyncResult _syncResult;
@@ -212,7 +288,7 @@ private:
      * Starts a sync (calling startSync)
      * if the policies allow for it
      */
-    void evaluateSync(const QStringList &pathList);
+    void evaluateSync(const QStringList &pathList, SyncReason reason);
 
     virtual void checkLocalPath();
 
@@ -231,6 +307,14 @@ private:
     bool       _online;
     bool       _enabled;
     QString    _backend;
+    SyncReason _syncReason;
+    double     _priorityWeight;
+    int        _basePollInterval;
+    QTimer    *_bulkWindowTimer;
+    qint64     _bulkTransferThreshold;
+    QTime      _bulkWindowStart;
+    QTime      _bulkWindowEnd;
+    bool       _planRequested;
 
 };
 
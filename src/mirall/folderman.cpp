@@ -18,6 +18,7 @@
 #include "mirall/syncresult.h"
 #include "mirall/inotify.h"
 #include "mirall/theme.h"
+#include "mirall/utility.h"
 #include "owncloudinfo.h"
 
 #ifdef Q_OS_MAC
@@ -35,7 +36,8 @@ namespace Mirall {
 
 FolderMan::FolderMan(QObject *parent) :
     QObject(parent),
-    _syncEnabled( true )
+    _syncEnabled( true ),
+    _planOnly( false )
 {
     // if QDir::mkpath would not be so stupid, I would not need to have this
     // duplication of folderConfigPath() here
@@ -89,31 +91,78 @@ int FolderMan::unloadAllFolders()
     int cnt = 0;
 
     // clear the list of existing folders.
-    Folder::MapIterator i(_folderMap);
-    while (i.hasNext()) {
-        i.next();
-        delete _folderMap.take( i.key() );
+    foreach( const QString& alias, _folderMap.keys() ) {
+        unloadFolder( alias );
         cnt++;
     }
+    _scheduler.clear();
     return cnt;
 }
 
+void FolderMan::unloadFolder( const QString& alias )
+{
+    if( !_folderMap.contains( alias ) ) return;
+
+    if( _currentSyncFolder == alias ) {
+        terminateSyncProcess( alias );
+    }
+    _scheduler.remove( alias );
+
+    qDebug() << "  ` -> unloading folder" << alias;
+    delete _folderMap.take( alias );
+}
+
+/*
+ * Compares the folder definitions on disk with the loaded folders. Only
+ * folders which were added, removed or changed their paths or backend are
+ * (re)created. All others keep their watcher, csync context and journal.
+ */
 int FolderMan::setupKnownFolders()
 {
   qDebug() << "* Setup folders from " << _folderConfigPath;
 
-  unloadAllFolders();
-
   QDir dir( _folderConfigPath );
   dir.setFilter(QDir::Files);
   QStringList list = dir.entryList();
 
-  foreach ( const QString& alias, list ) {
-    Folder *f = setupFolderFromConfigFile( alias );
+  QSet<QString> seenAliases;
+  foreach ( const QString& file, list ) {
+    FolderDefinition def;
+    if( !readFolderDefinition( file, &def ) ) {
+        continue;
+    }
+    seenAliases.insert( def.alias );
+
+    Folder *f = folder( def.alias );
+    if( f && !folderMatchesDefinition( f, def ) ) {
+        qDebug() << "  ` -> definition of" << def.alias << "changed, reloading.";
+        unloadFolder( def.alias );
+        f = 0;
+    }
+
+    if( f ) {
+        // only settings that can be applied in place may have changed.
+        f->setConfigFile( file );
+        f->setOnlyThisLANEnabled( def.onlyThisLAN );
+        f->setPriorityWeight( def.priorityWeight );
+        f->setBulkTransferWindow( def.bulkTransferThreshold, def.bulkTransferWindowStart,
+                                  def.bulkTransferWindowEnd );
+        continue;
+    }
+
+    f = createFolder( file, def );
     if( f ) {
         emit( folderSyncStateChange( f->alias() ) );
     }
   }
+
+  // remove the folders whose definition file is gone.
+  foreach( const QString& alias, _folderMap.keys() ) {
+      if( !seenAliases.contains( alias ) ) {
+          unloadFolder( alias );
+      }
+  }
+
   // return the number of valid folders.
   return _folderMap.size();
 }
@@ -133,6 +182,10 @@ bool FolderMan::ensureJournalGone(const QString &localPath)
     // remove old .csync_journal file
     QString stateDbFile = localPath+QLatin1String("/.csync_journal.db");
     while (QFile::exists(stateDbFile) && !QFile::remove(stateDbFile)) {
+        if( !Utility::hasGui() ) {
+            qWarning() << "Could not remove the old sync journal" << stateDbFile;
+            return false;
+        }
         int ret = QMessageBox::warning(0, tr("Could not reset folder state"),
                                        tr("An old sync journal '%1' was found, "
                                           "but could not be removed. Please make sure "
@@ -167,7 +220,7 @@ void FolderMan::terminateCurrentSync()
 #define PAR_O_TAG   QLatin1String("__PAR_OPEN__")
 #define PAR_C_TAG   QLatin1String("__PAR_CLOSE__")
 
-QString FolderMan::escapeAlias( const QString& alias ) const
+QString FolderMan::escapeAlias( const QString& alias )
 {
     QString a(alias);
 
@@ -186,7 +239,7 @@ QString FolderMan::escapeAlias( const QString& alias ) const
     return a;
 }
 
-QString FolderMan::unescapeAlias( const QString& alias ) const
+QString FolderMan::unescapeAlias( const QString& alias )
 {
     QString a(alias);
 
@@ -209,9 +262,19 @@ QString FolderMan::unescapeAlias( const QString& alias ) const
 // filename is the name of the file only, it does not include
 // the configuration directory path
 Folder* FolderMan::setupFolderFromConfigFile(const QString &file) {
-    Folder *folder = 0;
+    FolderDefinition def;
 
-    qDebug() << "  ` -> setting up:" << file;
+    if( !readFolderDefinition( file, &def ) ) {
+        return 0;
+    }
+    return createFolder( file, def );
+}
+
+bool FolderMan::readFolderDefinition( const QString& file, FolderDefinition *def )
+{
+    if( !def ) return false;
+
+    qDebug() << "  ` -> reading:" << file;
     QString escapedAlias(file);
     // check the unescaped variant (for the case the filename comes out
     // of the directory listing. If the file is not existing, escape the
@@ -225,7 +288,7 @@ Folder* FolderMan::setupFolderFromConfigFile(const QString &file) {
     }
     if( !cfgFile.isReadable() ) {
         qDebug() << "Can not read folder definition for alias " << cfgFile.filePath();
-        return folder;
+        return false;
     }
 
     QSettings settings( cfgFile.filePath(), QSettings::IniFormat);
@@ -241,48 +304,89 @@ Folder* FolderMan::setupFolderFromConfigFile(const QString &file) {
 
     settings.beginGroup( escapedAlias ); // read the group with the same name as the file which is the folder alias
 
-    QString path = settings.value(QLatin1String("localpath")).toString();
-    QString backend = settings.value(QLatin1String("backend")).toString();
-    QString targetPath = settings.value( QLatin1String("targetPath") ).toString();
+    def->path = settings.value(QLatin1String("localpath")).toString();
+    def->backend = settings.value(QLatin1String("backend")).toString();
+    def->targetPath = settings.value( QLatin1String("targetPath") ).toString();
     // QString connection = settings.value( QLatin1String("connection") ).toString();
-    QString alias = unescapeAlias( escapedAlias );
+    def->alias = unescapeAlias( escapedAlias );
+    def->onlyThisLAN = settings.value(QLatin1String("folder/onlyThisLAN"), false).toBool();
+    def->priorityWeight = settings.value(QLatin1String("priorityWeight"), 1.0).toDouble();
 
-    if (!backend.isEmpty()) {
+    // the transfer window falls back to the global one
+    MirallConfigFile cfg;
+    def->bulkTransferThreshold = settings.value(QLatin1String("bulkTransferThreshold"),
+                                                cfg.bulkTransferThreshold() / (1024*1024)).toLongLong() * 1024 * 1024;
+    QString windowStart = settings.value(QLatin1String("bulkTransferWindowStart"),
+                                         cfg.bulkTransferWindowStart()).toString();
+    QString windowEnd = settings.value(QLatin1String("bulkTransferWindowEnd"),
+                                       cfg.bulkTransferWindowEnd()).toString();
+    def->bulkTransferWindowStart = QTime::fromString(windowStart, QLatin1String("h:mm"));
+    def->bulkTransferWindowEnd = QTime::fromString(windowEnd, QLatin1String("h:mm"));
+
+    if( def->backend == QLatin1String("owncloud") ) {
+        // cut off the leading slash, oCUrl always has a trailing.
+        if( def->targetPath.startsWith(QLatin1Char('/')) ) {
+            def->targetPath.remove(0,1);
+        }
+    }
+    return true;
+}
 
-        if( backend == QLatin1String("owncloud") ) {
+bool FolderMan::folderMatchesDefinition( Folder *f, const FolderDefinition& def ) const
+{
+    if( !f ) return false;
 
-            // cut off the leading slash, oCUrl always has a trailing.
-            if( targetPath.startsWith(QLatin1Char('/')) ) {
-                targetPath.remove(0,1);
-            }
+    return f->backend() == def.backend
+        && QDir::cleanPath( f->path() ) == QDir::cleanPath( def.path )
+        && f->secondPath() == def.targetPath;
+}
+
+Folder* FolderMan::createFolder( const QString& file, const FolderDefinition& def )
+{
+    Folder *folder = 0;
+
+    qDebug() << "  ` -> setting up:" << file;
+
+    if (!def.backend.isEmpty()) {
 
-            folder = new ownCloudFolder( alias, path, targetPath, this );
+        if( def.backend == QLatin1String("owncloud") ) {
+            folder = new ownCloudFolder( def.alias, def.path, def.targetPath, this );
             folder->setConfigFile(file);
         } else {
-            qWarning() << "unknown backend" << backend;
+            qWarning() << "unknown backend" << def.backend;
             return 0;
         }
     }
 
     if( folder ) {
-        folder->setBackend( backend );
+        folder->setBackend( def.backend );
         // folder->setOnlyOnlineEnabled(settings.value("folder/onlyOnline", false).toBool());
-        folder->setOnlyThisLANEnabled(settings.value(QLatin1String("folder/onlyThisLAN"), false).toBool());
+        folder->setOnlyThisLANEnabled( def.onlyThisLAN );
+        folder->setPriorityWeight( def.priorityWeight );
+        folder->setBulkTransferWindow( def.bulkTransferThreshold, def.bulkTransferWindowStart,
+                                       def.bulkTransferWindowEnd );
 
-        _folderMap[alias] = folder;
-
-        qDebug() << "Adding folder to Folder Map " << folder;
-        /* Use a signal mapper to connect the signals to the alias */
-        connect(folder, SIGNAL(scheduleToSync(const QString&)), SLOT(slotScheduleSync(const QString&)));
-        connect(folder, SIGNAL(syncStateChange()), _folderChangeSignalMapper, SLOT(map()));
-        connect(folder, SIGNAL(syncStarted()), SLOT(slotFolderSyncStarted()));
-        connect(folder, SIGNAL(syncFinished(SyncResult)), SLOT(slotFolderSyncFinished(SyncResult)));
-
-        _folderChangeSignalMapper->setMapping( folder, folder->alias() );
+        registerFolder( folder );
     }
     return folder;
 }
 
+void FolderMan::registerFolder( Folder *folder )
+{
+    if( !folder ) return;
+
+    _folderMap[folder->alias()] = folder;
+
+    qDebug() << "Adding folder to Folder Map " << folder;
+    /* Use a signal mapper to connect the signals to the alias */
+    connect(folder, SIGNAL(scheduleToSync(const QString&)), SLOT(slotScheduleSync(const QString&)));
+    connect(folder, SIGNAL(syncStateChange()), _folderChangeSignalMapper, SLOT(map()));
+    connect(folder, SIGNAL(syncStarted()), SLOT(slotFolderSyncStarted()));
+    connect(folder, SIGNAL(syncFinished(SyncResult)), SLOT(slotFolderSyncFinished(SyncResult)));
+
+    _folderChangeSignalMapper->setMapping( folder, folder->alias() );
+}
+
 void FolderMan::slotEnableFolder( const QString& alias, bool enable )
 {
     if( ! _folderMap.contains( alias ) ) {
@@ -357,21 +461,40 @@ void FolderMan::slotScheduleSync( const QString& alias )
         return;
     }
 
-    if( ! _scheduleQueue.contains(alias )) {
-        _scheduleQueue.append(alias);
-    } else {
-        qDebug() << " II> Sync for folder " << alias << " already scheduled, do not enqueue!";
-    }
+    Folder *f = folder( alias );
+    if( !f ) return;
+
+    _scheduler.enqueue( alias, f->syncReason(), f->priorityWeight(), currentMSecs() );
 
     slotScheduleFolderSync();
 
 }
 
+qint64 FolderMan::currentMSecs()
+{
+    return QDateTime::currentMSecsSinceEpoch();
+}
+
+int FolderMan::scheduleQueueDepth() const
+{
+    return _scheduler.depth();
+}
+
+qint64 FolderMan::averageScheduleWaitTime() const
+{
+    return _scheduler.averageWaitTime();
+}
+
 void FolderMan::setSyncEnabled( bool enabled )
 {
     _syncEnabled = enabled;
 }
 
+void FolderMan::setPlanOnly( bool planOnly )
+{
+    _planOnly = planOnly;
+}
+
 /*
   * slot to start folder syncs.
   * It is either called from the slot where folders enqueue themselves for
@@ -389,12 +512,15 @@ void FolderMan::slotScheduleFolderSync()
         return;
     }
 
-    qDebug() << "XX slotScheduleFolderSync: folderQueue size: " << _scheduleQueue.count();
-    if( ! _scheduleQueue.isEmpty() ) {
-        const QString alias = _scheduleQueue.takeFirst();
+    qDebug() << "XX slotScheduleFolderSync: folderQueue size: " << _scheduler.depth();
+    if( _scheduler.depth() > 0 ) {
+        const QString alias = _scheduler.takeNext( currentMSecs() );
         if( _folderMap.contains( alias ) ) {
             Folder *f = _folderMap[alias];
             _currentSyncFolder = alias;
+            if( _planOnly ) {
+                f->setPlanRequested( true );
+            }
             f->startSync( QStringList() );
         }
     }
@@ -414,7 +540,7 @@ void FolderMan::slotFolderSyncFinished( const SyncResult& )
     qDebug() << "<===================================== sync finished for " << _currentSyncFolder;
 
     _currentSyncFolder.clear();
-    QTimer::singleShot(200, this, SLOT(slotScheduleFolderSync()));
+    QTimer::singleShot(SYNC_GAP_MSEC, this, SLOT(slotScheduleFolderSync()));
 }
 
 /**
@@ -448,7 +574,7 @@ void FolderMan::removeAllFolderDefinitions()
         slotRemoveFolder( f->alias() );
     }
     // clear the queue.
-    _scheduleQueue.clear();
+    _scheduler.clear();
 
 }
 
@@ -468,7 +594,7 @@ void FolderMan::removeFolder( const QString& alias )
 {
     Folder *f = 0;
 
-    _scheduleQueue.removeAll(alias);
+    _scheduler.remove(alias);
 
     if( _folderMap.contains( alias )) {
         qDebug() << "Removing " << alias;
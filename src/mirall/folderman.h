@@ -22,9 +22,13 @@
 #include "mirall/folder.h"
 #include "mirall/folderwatcher.h"
 #include "mirall/syncfileitem.h"
+#include "mirall/syncscheduler.h"
 
 class QSignalMapper;
 
+/* pause between the end of one folder sync and the start of the next */
+#define SYNC_GAP_MSEC 200
+
 namespace Mirall {
 
 class SyncResult;
@@ -66,6 +70,13 @@ public:
       */
     Folder* setupFolderFromConfigFile(const QString & );
 
+    /**
+      * adds a folder that was not created from a folder definition, e.g.
+      * by a benchmark, to the map and the scheduling. FolderMan takes the
+      * ownership. Reparsing the configuration unloads it again.
+      */
+    void registerFolder( Folder* );
+
     /**
      * wipes all folder defintions. No way back!
      */
@@ -83,6 +94,13 @@ public:
      */
     static bool ensureJournalGone(const QString &path);
 
+    /**
+     * Escaping of the alias which is used in QSettings AND the file
+     * system, thus need to be escaped.
+     */
+    static QString escapeAlias( const QString& );
+    static QString unescapeAlias( const QString& );
+
     /**
      * Creates a new and empty local directory.
      */
@@ -93,6 +111,16 @@ public:
      */
     void setProxy();
 
+    /**
+     * number of folders waiting in the sync queue.
+     */
+    int scheduleQueueDepth() const;
+
+    /**
+     * average time in milliseconds folders waited before their sync started.
+     */
+    qint64 averageScheduleWaitTime() const;
+
 signals:
     /**
       * signal to indicate a folder named by alias has changed its sync state.
@@ -118,6 +146,9 @@ public slots:
     // the current one will finish.
     void setSyncEnabled( bool );
 
+    // if set, every run only plans the sync, nothing is transferred.
+    void setPlanOnly( bool );
+
     void slotScheduleAllFolders();
 
 private slots:
@@ -134,20 +165,39 @@ private:
     void terminateCurrentSync();
     QString getBackupName( const QString& ) const;
 
-    // Escaping of the alias which is used in QSettings AND the file
-    // system, thus need to be escaped.
-    QString escapeAlias( const QString& ) const;
-    QString unescapeAlias( const QString& ) const;
-
     void removeFolder( const QString& );
 
+    // stops and deletes a single folder object, its definition is kept.
+    void unloadFolder( const QString& );
+
+    static qint64 currentMSecs();
+
+    // the content of one folder definition file below folders/
+    struct FolderDefinition {
+        QString alias;
+        QString path;
+        QString backend;
+        QString targetPath;
+        bool    onlyThisLAN;
+        double  priorityWeight;
+        qint64  bulkTransferThreshold;
+        QTime   bulkTransferWindowStart;
+        QTime   bulkTransferWindowEnd;
+    };
+
+    bool readFolderDefinition( const QString&, FolderDefinition * );
+    Folder* createFolder( const QString&, const FolderDefinition& );
+    // true if the folder can be kept as it is for the given definition
+    bool folderMatchesDefinition( Folder*, const FolderDefinition& ) const;
+
     FolderWatcher *_configFolderWatcher;
     Folder::Map    _folderMap;
     QString        _folderConfigPath;
     QSignalMapper *_folderChangeSignalMapper;
     QString        _currentSyncFolder;
-    QStringList    _scheduleQueue;
+    SyncScheduler  _scheduler;
     bool           _syncEnabled;
+    bool           _planOnly;
 };
 
 }
@@ -28,10 +28,6 @@
 #include <QStringList>
 #include <QTimer>
 
-/* minimum amount of seconds between two
-   events  to consider it a new event */
-#define DEFAULT_EVENT_INTERVAL_MSEC 1000
-
 #if defined(Q_OS_WIN)
 #include "mirall/folderwatcher_win.h"
 #elif defined(Q_OS_MAC)
@@ -47,7 +43,8 @@ FolderWatcher::FolderWatcher(const QString &root, QObject *parent)
       _eventsEnabled(true),
       _eventInterval(DEFAULT_EVENT_INTERVAL_MSEC),
       _root(root),
-      _processTimer(new QTimer(this))
+      _processTimer(new QTimer(this)),
+      _overflowCount(0)
 {
     _d = new FolderWatcherPrivate(this);
 
@@ -96,6 +93,11 @@ QStringList FolderWatcher::ignores() const
     return _ignores;
 }
 
+int FolderWatcher::overflowCount() const
+{
+    return _overflowCount;
+}
+
 bool FolderWatcher::eventsEnabled() const
 {
     return _eventsEnabled;
@@ -28,6 +28,10 @@
 
 class QTimer;
 
+/* minimum amount of milliseconds between two
+   events  to consider it a new event */
+#define DEFAULT_EVENT_INTERVAL_MSEC 1000
+
 namespace Mirall {
 
 class FolderWatcherPrivate;
@@ -93,6 +97,12 @@ public:
     void setEventInterval(int seconds);
 
     QStringList ignores() const;
+
+    /**
+     * Number of times the backend lost events since the watcher was
+     * created. Every loss notifies the root path.
+     */
+    int overflowCount() const;
 public slots:
     /**
      * Enabled or disables folderChanged() events.
@@ -134,6 +144,7 @@ private:
     // QStringList _pendingPaths;
     QTimer *_processTimer;
     QStringList _ignores;
+    int _overflowCount;
 
     friend class FolderWatcherPrivate;
 };
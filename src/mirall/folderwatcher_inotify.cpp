@@ -101,7 +101,12 @@ void FolderWatcherPrivate::slotINotifyEvent(int mask, int cookie, const QString
     }
 
     if (IN_Q_OVERFLOW & mask) {
-        //qDebug() << "OVERFLOW";
+        // we do not know what was lost, notify the root to get it all checked.
+        qDebug() << "* Inotify queue overflow, notifying" << _parent->root();
+        _parent->_pendingPathes[_parent->root()] |= mask;
+        _parent->_overflowCount++;
+        _parent->setProcessTimer();
+        return;
     }
 
     if (mask & IN_CREATE) {
@@ -78,11 +78,13 @@ void INotify::slotActivated(int fd)
     } while (false);
 
     /* TODO handle len == 0 */
+    if (len < 0)
+        return;
 
     // reset counter
     i = 0;
     // while there are enough events in the buffer
-    while(i + sizeof(struct inotify_event) < len) {
+    while(i + sizeof(struct inotify_event) <= (size_t) len) {
         // cast an inotify_event
         event = (struct inotify_event*)&_buffer[i];
         // with the help of watch descriptor, retrieve, corresponding INotify
@@ -96,6 +98,10 @@ void INotify::slotActivated(int fd)
             QStringList paths(_wds.keys(event->wd));
             foreach (QString path, paths)
                 emit notifyEvent(event->mask, event->cookie, path + "/" + QString::fromUtf8(event->name));
+        } else if (event->mask & IN_Q_OVERFLOW) {
+            // the kernel queue was full and events were lost, there is
+            // no watch and no name for this one.
+            emit notifyEvent(event->mask, 0, QString());
         }
 
         // increment counter
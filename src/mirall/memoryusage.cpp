@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) by agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "mirall/memoryusage.h"
+#include "mirall/utility.h"
+
+#include <QFile>
+#include <QStringList>
+
+#if defined(Q_OS_UNIX)
+#include <unistd.h>
+#include <sys/resource.h>
+#endif
+
+/* header of the shared data of a QString or QVector plus the allocator overhead */
+#define SHARED_DATA_BYTES 48
+/* allocator overhead of a single hash node */
+#define HEAP_BLOCK_BYTES 16
+/* csync_file_stat_t, its red black tree node and their heap blocks, roughly */
+#define CSYNC_TREE_NODE_BYTES 192
+
+namespace Mirall {
+
+qint64 MemoryUsage::stringBytes( const QString& str )
+{
+    // null and empty strings share a static instance
+    if( str.capacity() == 0 ) return 0;
+    return SHARED_DATA_BYTES + 2 * qint64( str.capacity() + 1 );
+}
+
+qint64 MemoryUsage::itemVectorBytes( const SyncFileItemVector& items )
+{
+    if( items.capacity() == 0 ) return 0;
+    qint64 bytes = SHARED_DATA_BYTES + qint64( items.capacity() ) * sizeof(SyncFileItem);
+    foreach( const SyncFileItem& item, items ) {
+        bytes += stringBytes( item._file ) + stringBytes( item._renameTarget );
+    }
+    return bytes;
+}
+
+qint64 MemoryUsage::itemIndexBytes( const QHash<QString, int>& index )
+{
+    if( index.isEmpty() ) return 0;
+    return SHARED_DATA_BYTES + qint64( index.capacity() ) * sizeof(void*)
+            + qint64( index.count() ) * (sizeof(QHashNode<QString, int>) + HEAP_BLOCK_BYTES);
+}
+
+qint64 MemoryUsage::csyncTreeBytes( int nodes, qint64 pathBytes )
+{
+    return qint64( nodes ) * CSYNC_TREE_NODE_BYTES + pathBytes;
+}
+
+qint64 MemoryUsage::residentBytes()
+{
+#if defined(Q_OS_LINUX)
+    // size and resident pages
+    QFile statm( QLatin1String("/proc/self/statm") );
+    if( !statm.open( QIODevice::ReadOnly ) ) return -1;
+    QList<QByteArray> fields = statm.readAll().split(' ');
+    if( fields.count() < 2 ) return -1;
+    return fields.at(1).toLongLong() * sysconf( _SC_PAGESIZE );
+#else
+    return -1;
+#endif
+}
+
+qint64 MemoryUsage::peakResidentBytes()
+{
+#if defined(Q_OS_LINUX)
+    // VmHWM, unlike ru_maxrss it follows resetPeakResident()
+    QFile status( QLatin1String("/proc/self/status") );
+    if( !status.open( QIODevice::ReadOnly | QIODevice::Text ) ) return -1;
+    while( !status.atEnd() ) {
+        QByteArray line = status.readLine();
+        if( line.startsWith( "VmHWM:" ) ) {
+            return line.mid( 6 ).trimmed().split(' ').first().toLongLong() * 1024;
+        }
+    }
+    return -1;
+#elif defined(Q_OS_MAC)
+    struct rusage usage;
+    if( getrusage( RUSAGE_SELF, &usage ) != 0 ) return -1;
+    return usage.ru_maxrss;
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    if( getrusage( RUSAGE_SELF, &usage ) != 0 ) return -1;
+    return qint64( usage.ru_maxrss ) * 1024;
+#else
+    return -1;
+#endif
+}
+
+bool MemoryUsage::resetPeakResident()
+{
+#if defined(Q_OS_LINUX)
+    QFile clearRefs( QLatin1String("/proc/self/clear_refs") );
+    if( !clearRefs.open( QIODevice::WriteOnly ) ) return false;
+    return clearRefs.write( "5" ) == 1;
+#else
+    return false;
+#endif
+}
+
+QString MemoryUsage::toString( const QHash<QString, qint64>& usage )
+{
+    QStringList components = usage.keys();
+    components.sort();
+    QStringList parts;
+    foreach( const QString& component, components ) {
+        parts << component + QLatin1Char(' ') + Utility::octetsToString( usage.value(component) );
+    }
+    return parts.join( QLatin1String(", ") );
+}
+
+qint64 MemoryUsage::total( const QHash<QString, qint64>& usage )
+{
+    qint64 bytes = 0;
+    foreach( qint64 b, usage ) {
+        bytes += b;
+    }
+    return bytes;
+}
+
+}
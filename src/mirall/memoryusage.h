@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) by agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef MIRALL_MEMORYUSAGE_H
+#define MIRALL_MEMORYUSAGE_H
+
+#include <QString>
+#include <QHash>
+
+#include "mirall/syncfileitem.h"
+
+namespace Mirall {
+
+/**
+ * Approximate heap usage of the per file data structures. The numbers
+ * are estimates from the sizes of the Qt containers and ignore what
+ * the allocator rounds up, they are meant to compare and to find the
+ * big consumers, not to add up to the resident size.
+ */
+class MemoryUsage
+{
+public:
+    static qint64 stringBytes( const QString& );
+
+    // the vector and the strings of its items
+    static qint64 itemVectorBytes( const SyncFileItemVector& );
+
+    // the nodes and buckets of a path index, the keys are shared with the items
+    static qint64 itemIndexBytes( const QHash<QString, int>& );
+
+    // csync trees with the given number of nodes and path bytes in total
+    static qint64 csyncTreeBytes( int nodes, qint64 pathBytes );
+
+    /**
+     * resident size of the process and its peak, -1 if the platform
+     * does not tell.
+     */
+    static qint64 residentBytes();
+    static qint64 peakResidentBytes();
+
+    // starts a new peak, only supported on Linux
+    static bool resetPeakResident();
+
+    // "component size, ..." for the log, sorted by component
+    static QString toString( const QHash<QString, qint64>& );
+
+    static qint64 total( const QHash<QString, qint64>& );
+};
+
+}
+
+#endif
@@ -24,6 +24,8 @@
 #include <QtGui>
 
 #define DEFAULT_REMOTE_POLL_INTERVAL 30000 // default remote poll time in milliseconds
+#define DEFAULT_CHUNK_SIZE (10*1024*1024) // upload chunk size in bytes
+#define MIN_CHUNK_SIZE (64*1024)
 
 #define CA_CERTS_KEY QLatin1String("CaCertificates")
 
@@ -68,14 +70,19 @@ void MirallConfigFile::setSeenVersion(const QString &version)
 
 QString MirallConfigFile::configPath() const
 {
-    QString dir = _confDir;
     if( _confDir.isEmpty() )
       _confDir = QDesktopServices::storageLocation(QDesktopServices::DataLocation);
+    QString dir = _confDir;
 
     if( !dir.endsWith(QLatin1Char('/')) ) dir.append(QLatin1Char('/'));
     return dir;
 }
 
+QString MirallConfigFile::instanceLockFile() const
+{
+    return configPath() + QLatin1String("instance.lock");
+}
+
 QString MirallConfigFile::excludeFile() const
 {
     // prefer sync-exclude.lst, but if it does not exist, check for
@@ -337,6 +344,86 @@ void MirallConfigFile::setRemotePollInterval(int interval, const QString &connec
     settings.sync();
 }
 
+qint64 MirallConfigFile::uploadChunkSize() const
+{
+    qint64 size = getValue( QLatin1String("chunkSize"), defaultConnection(),
+                            DEFAULT_CHUNK_SIZE ).toLongLong();
+    if( size < MIN_CHUNK_SIZE ) {
+        qDebug() << "Chunk size" << size << "is too small, reverting to" << DEFAULT_CHUNK_SIZE;
+        size = DEFAULT_CHUNK_SIZE;
+    }
+    return size;
+}
+
+qint64 MirallConfigFile::uploadChunkThreshold() const
+{
+    // by default every file that needs more than one chunk is chunked.
+    qint64 threshold = getValue( QLatin1String("chunkThreshold"), defaultConnection(),
+                                 uploadChunkSize() ).toLongLong();
+    return qMax( qint64(0), threshold );
+}
+
+int MirallConfigFile::uploadLimit() const
+{
+    return qMax( 0, getValue( QLatin1String("uploadLimit"), defaultConnection(), 0 ).toInt() );
+}
+
+int MirallConfigFile::downloadLimit() const
+{
+    return qMax( 0, getValue( QLatin1String("downloadLimit"), defaultConnection(), 0 ).toInt() );
+}
+
+int MirallConfigFile::uploadLimitPercent() const
+{
+    return qBound( 0, getValue( QLatin1String("uploadLimitPercent"), defaultConnection(), 0 ).toInt(), 100 );
+}
+
+int MirallConfigFile::downloadLimitPercent() const
+{
+    return qBound( 0, getValue( QLatin1String("downloadLimitPercent"), defaultConnection(), 0 ).toInt(), 100 );
+}
+
+void MirallConfigFile::setUploadLimit( int kbytes, int percent )
+{
+    setValue( QLatin1String("uploadLimit"), defaultConnection(), qMax(0, kbytes) );
+    setValue( QLatin1String("uploadLimitPercent"), defaultConnection(), qBound(0, percent, 100) );
+}
+
+void MirallConfigFile::setDownloadLimit( int kbytes, int percent )
+{
+    setValue( QLatin1String("downloadLimit"), defaultConnection(), qMax(0, kbytes) );
+    setValue( QLatin1String("downloadLimitPercent"), defaultConnection(), qBound(0, percent, 100) );
+}
+
+qint64 MirallConfigFile::bulkTransferThreshold() const
+{
+    // configured in MB
+    qint64 mbytes = getValue( QLatin1String("bulkTransferThreshold"), defaultConnection(), 0 ).toLongLong();
+    return qMax( qint64(0), mbytes ) * 1024 * 1024;
+}
+
+QString MirallConfigFile::bulkTransferWindowStart() const
+{
+    return getValue( QLatin1String("bulkTransferWindowStart"), defaultConnection(),
+                     QLatin1String("19:00") ).toString();
+}
+
+QString MirallConfigFile::bulkTransferWindowEnd() const
+{
+    return getValue( QLatin1String("bulkTransferWindowEnd"), defaultConnection(),
+                     QLatin1String("07:00") ).toString();
+}
+
+qint64 MirallConfigFile::measuredThroughput() const
+{
+    return qMax( qint64(0), getValue( QLatin1String("measuredThroughput"), defaultConnection(), 0 ).toLongLong() );
+}
+
+void MirallConfigFile::setMeasuredThroughput( qint64 bytesPerSec )
+{
+    setValue( QLatin1String("measuredThroughput"), defaultConnection(), qMax( qint64(0), bytesPerSec ) );
+}
+
 bool MirallConfigFile::passwordStorageAllowed( const QString& connection )
 {
     QString con( connection );
@@ -518,13 +605,24 @@ void MirallConfigFile::setProxyType(int proxyType,
     settings.sync();
 }
 
-QVariant MirallConfigFile::getValue(const QString& param, const QString& group) const
+QVariant MirallConfigFile::getValue(const QString& param, const QString& group,
+                                    const QVariant& defaultValue) const
 {
     QSettings settings( configFile(), QSettings::IniFormat );
     settings.setIniCodec( "UTF-8" );
     settings.beginGroup(group);
 
-    return settings.value(param);
+    return settings.value(param, defaultValue);
+}
+
+void MirallConfigFile::setValue(const QString& param, const QString& group, const QVariant& value)
+{
+    QSettings settings( configFile(), QSettings::IniFormat );
+    settings.setIniCodec( "UTF-8" );
+    settings.beginGroup(group);
+
+    settings.setValue(param, value);
+    settings.sync();
 }
 
 int MirallConfigFile::proxyType() const
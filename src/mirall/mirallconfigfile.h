@@ -42,6 +42,8 @@ public:
     QString configPath() const;
     QString configFile() const;
     QString excludeFile() const;
+    /* locked by the client or owncloudd while it syncs this configuration */
+    QString instanceLockFile() const;
 
     bool exists();
 
@@ -79,6 +81,32 @@ public:
     /* Set poll interval. Value in microseconds has to be larger than 5000 */
     void setRemotePollInterval(int interval, const QString& connection = QString() );
 
+    /* Files larger than the threshold are uploaded in chunks of
+       uploadChunkSize bytes. */
+    qint64 uploadChunkSize() const;
+    qint64 uploadChunkThreshold() const;
+
+    /* Bandwidth limits in KB/s, 0 means no absolute limit. The percent
+       variants limit to a share of the measured capacity instead and
+       take precedence if set. */
+    int uploadLimit() const;
+    int downloadLimit() const;
+    int uploadLimitPercent() const;
+    int downloadLimitPercent() const;
+    void setUploadLimit( int kbytes, int percent = 0 );
+    void setDownloadLimit( int kbytes, int percent = 0 );
+
+    /* Runs which would transfer more than the threshold are deferred
+       until the transfer window opens. A threshold of 0 disables it. */
+    qint64 bulkTransferThreshold() const;
+    QString bulkTransferWindowStart() const;
+    QString bulkTransferWindowEnd() const;
+
+    // average transfer rate of earlier sync runs in bytes per second,
+    // used to estimate how long a planned sync takes.
+    qint64 measuredThroughput() const;
+    void setMeasuredThroughput( qint64 bytesPerSec );
+
     // Custom Config: accept the custom config to become the main one.
     void acceptCustomConfig();
     // Custom Config: remove the custom config file.
@@ -109,7 +137,9 @@ protected:
     bool writePassword( const QString& passwd, const QString& connection = QString() );
 
 private:
-    QVariant getValue(const QString& param, const QString& group) const;
+    QVariant getValue(const QString& param, const QString& group,
+                      const QVariant& defaultValue = QVariant()) const;
+    void setValue(const QString& param, const QString& group, const QVariant& value);
 
 
 private:
@@ -19,6 +19,8 @@
 #include "mirall/credentialstore.h"
 #include "mirall/logger.h"
 #include "mirall/utility.h"
+#include "mirall/syncplan.h"
+#include "mirall/memoryusage.h"
 
 #include <csync.h>
 
@@ -30,11 +32,16 @@
 #include <QStringList>
 #include <QTextStream>
 #include <QTimer>
+#include <QTime>
 #include <QNetworkProxy>
 #include <QNetworkAccessManager>
 #include <QNetworkProxyFactory>
 #include <QMessageBox>
 #include <QPushButton>
+#include <QtConcurrentRun>
+
+/* minimum bytes a run has to transfer to update the measured throughput */
+#define MIN_MEASURED_TRANSFER (1024*1024)
 
 namespace Mirall {
 
@@ -69,52 +76,142 @@ ownCloudFolder::ownCloudFolder(const QString &alias,
     , _csync(0)
     , _csyncError(false)
     , _csyncUnavail(false)
+    , _csyncTerminated(false)
+    , _transferDeferred(false)
+    , _planRun(false)
+    , _syncPending(false)
+    , _initWatcher(new QFutureWatcher<CSyncInitResult>(this))
     , _csync_ctx(0)
 {
     ServerActionNotifier *notifier = new ServerActionNotifier(this);
     connect(notifier, SIGNAL(guiLog(QString,QString)), Logger::instance(), SIGNAL(guiLog(QString,QString)));
     connect(this, SIGNAL(syncFinished(SyncResult)), notifier, SLOT(slotSyncFinished(SyncResult)));
+    connect(_initWatcher, SIGNAL(finished()), SLOT(slotInitFinished()));
     qDebug() << "****** ownCloud folder using watcher *******";
     // The folder interval is set in the folder parent class.
+
+    // the csync context is created by the first startSync(), with the
+    // server url that is valid then.
 }
 
-bool ownCloudFolder::init()
+void ownCloudFolder::init()
 {
+    if( _csync_ctx || _initWatcher->isRunning() ) {
+        return;
+    }
+    _errors.clear();
+    _csyncError = false;
+
+    // everything that touches Qt singletons or settings is read here
+    // in the GUI thread, the worker only deals with csync.
     QString url = replaceScheme(ownCloudInfo::instance()->webdavUrl() + secondPath());
     QString localpath = path();
 
-    if( csync_create( &_csync_ctx, localpath.toUtf8().data(), url.toUtf8().data() ) < 0 ) {
+    MirallConfigFile cfgFile;
+    QString configPath  = cfgFile.configPath();
+    QString excludeList = cfgFile.excludeFile();
+
+    qDebug() << "    * starting csync init for" << alias();
+    _initWatcher->setFuture( QtConcurrent::run( &ownCloudFolder::initCSyncContext,
+                                                localpath, url, configPath, excludeList ) );
+}
+
+// runs in a worker thread, do not touch any member here.
+CSyncInitResult ownCloudFolder::initCSyncContext( const QString& localpath, const QString& url,
+                                                  const QString& configPath, const QString& excludeList )
+{
+    CSyncInitResult result;
+    CSYNC *ctx = 0;
+
+    // csync_init resets the network session other contexts share, wait
+    // until no sync is running.
+    QMutexLocker locker( CSyncThread::syncMutex() );
+
+    if( csync_create( &ctx, localpath.toUtf8().data(), url.toUtf8().data() ) < 0 ) {
         qDebug() << "Unable to create csync-context!";
-        slotCSyncError(tr("Unable to create csync-context"));
-        _csync_ctx = 0;
-    } else {
-        csync_set_log_callback(   _csync_ctx, csyncLogCatcher );
-        csync_set_log_verbosity(_csync_ctx, 11);
+        result._error = tr("Unable to create csync-context");
+        return result;
+    }
 
-        MirallConfigFile cfgFile;
-        csync_set_config_dir( _csync_ctx, cfgFile.configPath().toUtf8() );
+    csync_set_log_callback(   ctx, csyncLogCatcher );
+    csync_set_log_verbosity(ctx, 11);
 
-        csync_enable_conflictcopys(_csync_ctx);
-        QString excludeList = cfgFile.excludeFile();
-        if( !excludeList.isEmpty() ) {
-            qDebug() << "==== added CSync exclude List: " << excludeList.toUtf8();
-            csync_add_exclude_list( _csync_ctx, excludeList.toUtf8() );
-        }
-        csync_set_auth_callback( _csync_ctx, getauth );
+    csync_set_config_dir( ctx, configPath.toUtf8() );
 
-        if( csync_init( _csync_ctx ) < 0 ) {
-            qDebug() << "Could not initialize csync!" << csync_get_error(_csync_ctx) << csync_get_error_string(_csync_ctx);
-            slotCSyncError(CSyncThread::csyncErrorToString(csync_get_error(_csync_ctx), csync_get_error_string(_csync_ctx)));
-            csync_destroy(_csync_ctx);
-            _csync_ctx = 0;
-        }
+    csync_enable_conflictcopys(ctx);
+    if( !excludeList.isEmpty() ) {
+        qDebug() << "==== added CSync exclude List: " << excludeList.toUtf8();
+        csync_add_exclude_list( ctx, excludeList.toUtf8() );
+    }
+    csync_set_auth_callback( ctx, getauth );
+
+    QTime t;
+    t.start();
+    if( csync_init( ctx ) < 0 ) {
+        qDebug() << "Could not initialize csync!" << csync_get_error(ctx) << csync_get_error_string(ctx);
+        result._error = CSyncThread::csyncErrorToString(csync_get_error(ctx), csync_get_error_string(ctx));
+        csync_destroy(ctx);
+        return result;
+    }
+    qDebug() << "csync init for" << localpath << "took" << t.elapsed() << "msec";
+
+    result._ctx = ctx;
+    return result;
+}
+
+void ownCloudFolder::slotInitFinished()
+{
+    CSyncInitResult result = _initWatcher->result();
+
+    if( !result._error.isEmpty() ) {
+        slotCSyncError( result._error );
+    }
+    _csync_ctx = result._ctx;
+    if( _csync_ctx ) {
         setProxy();
     }
-    return _csync_ctx;
+
+    if( _syncPending ) {
+        _syncPending = false;
+        if( _csync_ctx ) {
+            startSync( QStringList() );
+        } else {
+            qDebug() << Q_FUNC_INFO << "init failed.";
+            // the error is already set, the server was not contacted.
+            _csyncTerminated = true;
+            slotCSyncFinished();
+        }
+    }
+}
+
+CSyncInitReaper::CSyncInitReaper( QFutureWatcher<CSyncInitResult> *watcher )
+    : QObject(0)
+    , _watcher(watcher)
+{
+    _watcher->setParent(this);
+    connect(_watcher, SIGNAL(finished()), SLOT(slotInitFinished()));
+}
+
+void CSyncInitReaper::slotInitFinished()
+{
+    CSYNC *ctx = _watcher->result()._ctx;
+    if( ctx ) {
+        csync_destroy(ctx);
+    }
+    deleteLater();
 }
 
 ownCloudFolder::~ownCloudFolder()
 {
+    if( _initWatcher->isRunning() ) {
+        qDebug() << "    * csync init of" << alias() << "still running, destroying the context later";
+        disconnect(_initWatcher, 0, this, 0);
+        new CSyncInitReaper( _initWatcher );
+        _initWatcher = 0;
+    } else if( !_csync_ctx && _initWatcher->future().resultCount() > 0 ) {
+        // finished, but slotInitFinished() was not called yet
+        _csync_ctx = _initWatcher->result()._ctx;
+    }
     if( _thread ) {
         _thread->quit();
         csync_request_abort(_csync_ctx);
@@ -140,18 +237,70 @@ void ownCloudFolder::setProxy()
             qDebug() << "Passing" << proxy.hostName() << "of proxy type " << proxy.type()
                      << " to csync for" << proxyUrl;
         }
-        int proxyPort = proxy.port();
+        setModuleProxy( _csync_ctx, proxy );
+    }
+}
 
-        csync_set_module_property(_csync_ctx, "proxy_type", (char*) proxyTypeToCStr(proxy.type()) );
-        csync_set_module_property(_csync_ctx, "proxy_host", proxy.hostName().toUtf8().data() );
-        csync_set_module_property(_csync_ctx, "proxy_port", &proxyPort );
-        csync_set_module_property(_csync_ctx, "proxy_user", proxy.user().toUtf8().data()     );
-        csync_set_module_property(_csync_ctx, "proxy_pwd" , proxy.password().toUtf8().data() );
+void ownCloudFolder::setModuleProxy( CSYNC *ctx, const QNetworkProxy& proxy )
+{
+    int proxyPort = proxy.port();
+
+    csync_set_module_property(ctx, "proxy_type", (char*) proxyTypeToCStr(proxy.type()) );
+    csync_set_module_property(ctx, "proxy_host", proxy.hostName().toUtf8().data() );
+    csync_set_module_property(ctx, "proxy_port", &proxyPort );
+    csync_set_module_property(ctx, "proxy_user", proxy.user().toUtf8().data()     );
+    csync_set_module_property(ctx, "proxy_pwd" , proxy.password().toUtf8().data() );
 
-        csync_set_module_property(_csync_ctx, "csync_context", _csync_ctx);
+    csync_set_module_property(ctx, "csync_context", ctx);
+}
+
+// csync returns an error for properties the module does not know
+static void setModuleProperty( CSYNC *ctx, const char *key, void *value )
+{
+    if( csync_set_module_property( ctx, key, value ) < 0 ) {
+        qDebug() << "WRN: csync rejected the module property" << key;
     }
 }
 
+void ownCloudFolder::setTransferOptions()
+{
+    if( !_csync_ctx ) return;
+
+    // the module keeps these in globals which csync_propagate reads, so
+    // they are only changed while no sync or csync init is running.
+    QMutex *syncMutex = CSyncThread::syncMutex();
+    if( !syncMutex->tryLock() ) {
+        qDebug() << "csync is busy, transfer options of" << alias() << "apply from the next run";
+        return;
+    }
+
+    setModuleTransferOptions( _csync_ctx );
+
+    syncMutex->unlock();
+}
+
+void ownCloudFolder::setModuleTransferOptions( CSYNC *ctx )
+{
+    MirallConfigFile cfgFile;
+
+    // large uploads are split into chunks which are assembled on the
+    // server, a failure only repeats the current chunk.
+    int64_t chunkSize = cfgFile.uploadChunkSize();
+    int64_t chunkThreshold = cfgFile.uploadChunkThreshold();
+    setModuleProperty(ctx, "hbf_block_size", &chunkSize);
+    setModuleProperty(ctx, "hbf_threshold", &chunkThreshold);
+
+    // The module expects bytes per second, a negative value is taken as
+    // percentage of the measured link capacity. Only one folder syncs at
+    // a time, so the limit is effectively shared by all folders.
+    int64_t uploadLimit = cfgFile.uploadLimitPercent() > 0 ?
+                -cfgFile.uploadLimitPercent() : int64_t(cfgFile.uploadLimit()) * 1024;
+    int64_t downloadLimit = cfgFile.downloadLimitPercent() > 0 ?
+                -cfgFile.downloadLimitPercent() : int64_t(cfgFile.downloadLimit()) * 1024;
+    setModuleProperty(ctx, "bandwidth_limit_upload", &uploadLimit);
+    setModuleProperty(ctx, "bandwidth_limit_download", &downloadLimit);
+}
+
 const char* ownCloudFolder::proxyTypeToCStr(QNetworkProxy::ProxyType type)
 {
     switch (type) {
@@ -255,15 +404,14 @@ void ownCloudFolder::startSync()
 void ownCloudFolder::startSync(const QStringList &pathList)
 {
     if (!_csync_ctx) {
-        // no _csync_ctx yet,  initialize it.
+        // no _csync_ctx yet, initialize it. The sync starts from
+        // slotInitFinished() once the journal is loaded.
+        qDebug() << "*** csync context of" << alias() << "not ready, sync starts after init.";
+        _syncPending = true;
+        _syncResult.setStatus( SyncResult::SyncPrepare );
+        emit syncStateChange();
         init();
-
-        if (!_csync_ctx) {
-            qDebug() << Q_FUNC_INFO << "init failed.";
-            // the error should already be set
-            QMetaObject::invokeMethod(this, "slotCSyncFinished", Qt::QueuedConnection);
-            return;
-        }
+        return;
     }
 
     if (_thread && _thread->isRunning()) {
@@ -277,10 +425,17 @@ void ownCloudFolder::startSync(const QStringList &pathList)
     _errors.clear();
     _csyncError = false;
     _csyncUnavail = false;
+    _csyncTerminated = false;
+    _transferDeferred = false;
+    _planRun = planRequested();
+    setPlanRequested( false );
 
-    MirallConfigFile cfgFile;
+    setTransferOptions();
 
     _syncResult.clearErrors();
+    _syncResult.clearPhaseTimes();
+    _syncResult.setTransferred( 0, 0, 0 );
+    _syncResult.setDeferred( 0, QTime() );
     _syncResult.setStatus( SyncResult::SyncPrepare );
     emit syncStateChange();
 
@@ -288,6 +443,9 @@ void ownCloudFolder::startSync(const QStringList &pathList)
     qDebug() << "*** Start syncing";
     _thread = new QThread(this);
     _csync = new CSyncThread( _csync_ctx );
+    _csync->setLocalPath( path() );
+    _csync->setBulkTransferLimit( bulkTransferLimit() );
+    _csync->setPlanOnly( _planRun );
     _csync->moveToThread(_thread);
 
     qRegisterMetaType<SyncFileItemVector>("SyncFileItemVector");
@@ -300,6 +458,9 @@ void ownCloudFolder::startSync(const QStringList &pathList)
     connect(_csync, SIGNAL(finished()), SLOT(slotCSyncFinished()), Qt::QueuedConnection);
     connect(_csync, SIGNAL(csyncError(QString)), SLOT(slotCSyncError(QString)), Qt::QueuedConnection);
     connect(_csync, SIGNAL(csyncUnavailable()), SLOT(slotCsyncUnavailable()), Qt::QueuedConnection);
+    connect(_csync, SIGNAL(phaseTime(QString,int)), SLOT(slotCSyncPhaseTime(QString,int)), Qt::QueuedConnection);
+    connect(_csync, SIGNAL(transferProgress(int,qint64,qint64)), SLOT(slotTransferProgress(int,qint64,qint64)), Qt::QueuedConnection);
+    connect(_csync, SIGNAL(transferDeferred(qint64)), SLOT(slotTransferDeferred(qint64)), Qt::QueuedConnection);
 
     //blocking connection so the message box happens in this thread, but block the csync thread.
     connect(_csync, SIGNAL(aboutToRemoveAllFiles(SyncFileItem::Direction,bool*)),
@@ -328,6 +489,25 @@ void ownCloudFolder::slotCsyncUnavailable()
     _csyncUnavail = true;
 }
 
+void ownCloudFolder::slotCSyncPhaseTime( const QString& phase, int msec )
+{
+    qDebug() << "    * csync phase" << phase << "took" << msec << "msec";
+    _syncResult.setPhaseTime( phase, msec );
+}
+
+void ownCloudFolder::slotTransferProgress( int files, qint64 uploaded, qint64 downloaded )
+{
+    _syncResult.setTransferred( files, uploaded, downloaded );
+}
+
+void ownCloudFolder::slotTransferDeferred( qint64 plannedBytes )
+{
+    qDebug() << "    * transfer of" << plannedBytes << "bytes deferred until"
+             << bulkTransferWindowStart().toString();
+    _transferDeferred = true;
+    _syncResult.setDeferred( plannedBytes, bulkTransferWindowStart() );
+}
+
 void ownCloudFolder::slotCSyncFinished()
 {
     qDebug() << "-> CSync Finished slot with error " << _csyncError;
@@ -340,21 +520,72 @@ void ownCloudFolder::slotCSyncFinished()
         qDebug() << "    * owncloud csync thread finished with error";
     } else if (_csyncUnavail) {
         _syncResult.setStatus(SyncResult::Unavailable);
+    } else if (_planRun) {
+        _syncResult.setStatus(SyncResult::Planned);
+    } else if (_transferDeferred) {
+        _syncResult.setStatus(SyncResult::Deferred);
     } else {
         _syncResult.setStatus(SyncResult::Success);
+        updateMeasuredThroughput();
     }
 
     if( _thread && _thread->isRunning() ) {
         _thread->quit();
     }
+    updateMemoryUsage();
+    // a terminated run or a failed init says nothing about the server,
+    // so it must not back off the polling.
+    if( !_csyncTerminated ) {
+        adjustPollInterval();
+    }
+    _csyncTerminated = false;
     emit syncFinished( _syncResult );
 }
 
+void ownCloudFolder::updateMemoryUsage()
+{
+    SyncFileItemVector resultItems = _syncResult.syncFileItemVector();
+    QHash<QString, qint64> usage;
+    if( _csync ) {
+        usage = _csync->memoryUsage( resultItems );
+    }
+    usage.insert( QLatin1String("syncResultItems"), MemoryUsage::itemVectorBytes( resultItems ) );
+    usage.insert( QLatin1String("folderItems"), MemoryUsage::itemVectorBytes( _items ) );
+    _syncResult.setMemoryUsage( usage );
+
+    qDebug() << "* Memory of" << alias() << ":" << MemoryUsage::toString( usage )
+             << "; process resident" << Utility::octetsToString( MemoryUsage::residentBytes() )
+             << "peak" << Utility::octetsToString( MemoryUsage::peakResidentBytes() );
+}
+
 void ownCloudFolder::slotThreadTreeWalkResult(const SyncFileItemVector& items)
 {
+    if( _planRun ) {
+        // keep the items of the last real sync, the plan is kept apart.
+        MirallConfigFile cfg;
+        SyncPlan plan( items, cfg.measuredThroughput() );
+        qDebug() << "* Sync plan for" << alias() << ":" << plan.summary();
+        _syncResult.setPlan( plan );
+        return;
+    }
     _syncResult.setSyncFileItemVector(items);
 }
 
+void ownCloudFolder::updateMeasuredThroughput()
+{
+    // runs with few bytes are dominated by the per file overhead and
+    // say nothing about the link.
+    if( _syncResult.transferredBytes() < MIN_MEASURED_TRANSFER ) return;
+
+    qint64 rate = _syncResult.throughput();
+    if( rate <= 0 ) return;
+
+    MirallConfigFile cfg;
+    qint64 average = cfg.measuredThroughput();
+    average = average > 0 ? (3*average + rate) / 4 : rate;
+    cfg.setMeasuredThroughput( average );
+}
+
 void ownCloudFolder::slotTerminateSync()
 {
     qDebug() << "folder " << alias() << " Terminating!";
@@ -383,6 +614,7 @@ void ownCloudFolder::slotTerminateSync()
 
     _errors.append( tr("The CSync thread terminated.") );
     _csyncError = true;
+    _csyncTerminated = true;
     qDebug() << "-> CSync Terminated!";
     slotCSyncFinished();
 }
@@ -440,6 +672,10 @@ ServerActionNotifier::ServerActionNotifier(QObject *parent)
 
 void ServerActionNotifier::slotSyncFinished(const SyncResult &result)
 {
+    // plan-only and deferred runs did not transfer their items.
+    if (result.status() == SyncResult::Planned || result.status() == SyncResult::Deferred)
+        return;
+
     SyncFileItemVector items = result.syncFileItemVector();
     if (items.count() == 0)
         return;
@@ -511,6 +747,14 @@ void ownCloudFolder::slotAboutToRemoveAllFiles(SyncFileItem::Direction direction
            "This might be because the folder was silently reconfigured, or that all"
            "the file were manually removed.\n"
            "Are you sure you want to perform this operation?");
+    if( !Utility::hasGui() ) {
+        // nobody to ask, keep the files and leave the journal alone so
+        // that the next run stops at the same point again.
+        qWarning() << "Refusing to remove all files of" << alias();
+        slotCSyncError( msg.arg(alias()) );
+        *cancel = true;
+        return;
+    }
     QMessageBox msgBox(QMessageBox::Warning, tr("Remove All Files?"),
                        msg.arg(alias()));
     msgBox.addButton(tr("Remove all files"), QMessageBox::DestructiveRole);
@@ -18,6 +18,7 @@
 #include <QMutex>
 #include <QThread>
 #include <QStringList>
+#include <QFutureWatcher>
 
 #include "mirall/folder.h"
 #include "mirall/csyncthread.h"
@@ -55,6 +56,34 @@ signals:
 private:
 };
 
+/**
+ * Outcome of the csync context creation which runs on a worker thread.
+ */
+struct CSyncInitResult {
+    CSyncInitResult() : _ctx(0) {}
+    CSYNC  *_ctx;
+    QString _error;
+};
+
+/**
+ * Takes over the init of a folder that is deleted while its csync context
+ * is still being created, and destroys the context once the worker is done.
+ * The worker may wait for the sync of another folder, so the folder must
+ * not block on it.
+ */
+class CSyncInitReaper : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CSyncInitReaper( QFutureWatcher<CSyncInitResult> *watcher );
+
+private slots:
+    void slotInitFinished();
+
+private:
+    QFutureWatcher<CSyncInitResult> *_watcher;
+};
+
 class ownCloudFolder : public Folder
 {
     Q_OBJECT
@@ -74,6 +103,22 @@ public:
 
     void setProxy();
 
+    /**
+     * Passes the transfer related settings from the config file to the
+     * owncloud module. Called before every sync run, so changes apply
+     * from the next run without a restart. Does nothing while another
+     * sync or csync init holds the csync sync mutex.
+     */
+    void setTransferOptions();
+
+    /**
+     * Pass the proxy and the transfer settings to the owncloud module of
+     * the given csync context. Also used by owncloudcmd, which syncs
+     * without an ownCloudFolder.
+     */
+    static void setModuleProxy( CSYNC *ctx, const QNetworkProxy& proxy );
+    static void setModuleTransferOptions( CSYNC *ctx );
+
 public slots:
     void startSync();
     void slotTerminateSync();
@@ -88,6 +133,10 @@ private slots:
     void slotCSyncError(const QString& );
     void slotCsyncUnavailable();
     void slotCSyncFinished();
+    void slotInitFinished();
+    void slotCSyncPhaseTime( const QString&, int );
+    void slotTransferProgress( int, qint64, qint64 );
+    void slotTransferDeferred( qint64 );
 
 private:
     static int getauth(const char *prompt,
@@ -97,9 +146,22 @@ private:
                              int verify,
                              void *userdata
                              );
-    const char* proxyTypeToCStr(QNetworkProxy::ProxyType type);
+    static const char* proxyTypeToCStr(QNetworkProxy::ProxyType type);
+
+
+    // folds the transfer rate of the last run into the stored average
+    void updateMeasuredThroughput();
+
+    // puts the approximate memory per component into the sync result and the log
+    void updateMemoryUsage();
 
-    bool init();
+    /**
+     * Starts creating the csync context and loading the journal on a
+     * worker thread. slotInitFinished() is called once that is done.
+     */
+    void init();
+    static CSyncInitResult initCSyncContext( const QString& localpath, const QString& url,
+                                             const QString& configPath, const QString& excludeList );
 
     QString      _secondPath;
     QThread     *_thread;
@@ -107,8 +169,13 @@ private:
     QStringList  _errors;
     bool         _csyncError;
     bool         _csyncUnavail;
+    bool         _csyncTerminated;
+    bool         _transferDeferred;
+    bool         _planRun;
     bool         _wipeDb;
+    bool         _syncPending;
     SyncFileItemVector _items;
+    QFutureWatcher<CSyncInitResult> *_initWatcher;
 
     CSYNC *_csync_ctx;
 };
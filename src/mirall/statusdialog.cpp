@@ -19,6 +19,8 @@
 #include "mirall/mirallconfigfile.h"
 #include "mirall/credentialstore.h"
 #include "mirall/fileitemdialog.h"
+#include "mirall/memoryusage.h"
+#include "mirall/utility.h"
 
 #include <QtCore>
 #include <QtGui>
@@ -240,11 +242,13 @@ StatusDialog::StatusDialog( Theme *theme, QWidget *parent) :
 
   connect(_ButtonEnable, SIGNAL(clicked()), this, SLOT(slotEnableFolder()));
   connect(_ButtonInfo,   SIGNAL(clicked()), this, SLOT(slotInfoFolder()));
+  connect(_ButtonPlan,   SIGNAL(clicked()), this, SLOT(slotPlanFolder()));
   connect(_ButtonAdd,    SIGNAL(clicked()), this, SLOT(slotAddSync()));
 
   _ButtonRemove->setEnabled(false);
   _ButtonEnable->setEnabled(false);
   _ButtonInfo->setEnabled(false);
+  _ButtonPlan->setEnabled(false);
   _ButtonAdd->setEnabled(true);
 
   connect(_folderList, SIGNAL(clicked(QModelIndex)), SLOT(slotFolderActivated(QModelIndex)));
@@ -266,6 +270,7 @@ void StatusDialog::slotFolderActivated( const QModelIndex& indx )
   _ButtonRemove->setEnabled( state );
   _ButtonEnable->setEnabled( state );
   _ButtonInfo->setEnabled( state );
+  _ButtonPlan->setEnabled( state );
 
   if ( state ) {
     bool folderEnabled = _model->data( indx, FolderViewDelegate::FolderSyncEnabled).toBool();
@@ -331,6 +336,7 @@ void StatusDialog::buttonsSetEnabled()
     _ButtonEnable->setEnabled(isSelected);
     _ButtonRemove->setEnabled(isSelected);
     _ButtonInfo->setEnabled(isSelected);
+    _ButtonPlan->setEnabled(isSelected);
 }
 
 void StatusDialog::slotUpdateFolderState( Folder *folder )
@@ -371,7 +377,16 @@ void StatusDialog::folderToModelItem( QStandardItem *item, Folder *f )
 
     QString errors = res.errorStrings().join(QLatin1String("<br/>"));
 
-    item->setData( _theme->statusHeaderText( status ),  Qt::ToolTipRole );
+    QString toolTip = _theme->statusHeaderText( status );
+    qint64 memory = MemoryUsage::total( res.memoryUsage() );
+    if( memory > 0 ) {
+        toolTip += tr("\nMemory held for the last sync: about %1").arg( Utility::octetsToString( memory ) );
+    }
+    if( res.pollInterval() > 0 ) {
+        toolTip += tr("\nNext check for remote changes in %1 seconds: %2")
+                   .arg( res.pollInterval() / 1000 ).arg( res.pollIntervalReason() );
+    }
+    item->setData( toolTip,                             Qt::ToolTipRole );
     if( f->syncEnabled() ) {
         item->setData( _theme->syncStateIcon( status ), FolderViewDelegate::FolderStatusIconRole );
     } else {
@@ -434,6 +449,18 @@ void StatusDialog::slotInfoFolder()
   }
 }
 
+void StatusDialog::slotPlanFolder()
+{
+  QModelIndex selected = _folderList->selectionModel()->currentIndex();
+  if( selected.isValid() ) {
+    QString alias = _model->data( selected, FolderViewDelegate::FolderAliasRole ).toString();
+    qDebug() << "Plan Folder alias " << alias;
+    if( !alias.isEmpty() ) {
+      emit(planFolderAlias( alias ));
+    }
+  }
+}
+
 void StatusDialog::slotAddSync()
 {
     qDebug() << "Add a sync requested.";
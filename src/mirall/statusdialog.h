@@ -74,6 +74,7 @@ signals:
     void removeFolderAlias( const QString& );
     void enableFolderAlias( const QString&, const bool );
     void infoFolderAlias( const QString& );
+    void planFolderAlias( const QString& );
     void openFolderAlias( const QString& );
 
     /* start the add a folder wizard. */
@@ -86,6 +87,7 @@ public slots:
     void slotOpenOC();
     void slotEnableFolder();
     void slotInfoFolder();
+    void slotPlanFolder();
     void slotAddSync();
     void slotAddFolder( Folder* );
     void slotUpdateFolderState( Folder* );
@@ -15,7 +15,7 @@ public:
         Up,
         Down } Direction;
 
-    SyncFileItem() {}
+    SyncFileItem() : _size(-1) {}
 
     bool operator==(const SyncFileItem& item) const {
         return item._file == this->_file;
@@ -30,6 +30,8 @@ public:
     QString _renameTarget;
     csync_instructions_e _instruction;
     Direction _dir;
+    // bytes to transfer, -1 if unknown
+    qint64 _size;
 };
 
 typedef QVector<SyncFileItem> SyncFileItemVector;
@@ -0,0 +1,189 @@
+/*
+ * Copyright (C) by agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "mirall/syncplan.h"
+#include "mirall/utility.h"
+
+#include <QCoreApplication>
+#include <QDir>
+
+#include <algorithm>
+
+/* number of files listed as the largest transfers */
+#define PLAN_LARGEST_ITEMS 10
+
+namespace Mirall {
+
+static bool largerThan( const SyncFileItem& a, const SyncFileItem& b )
+{
+    return a._size > b._size;
+}
+
+SyncPlan::SyncPlan()
+    : _unknownSize(0),
+      _throughput(0)
+{
+}
+
+SyncPlan::SyncPlan( const SyncFileItemVector& items, qint64 throughput )
+    : _unknownSize(0),
+      _throughput(throughput)
+{
+    SyncFileItemVector sized;
+
+    foreach( const SyncFileItem& item, items ) {
+        qint64 size = qMax( qint64(0), item._size );
+
+        _dirCount[item._dir]++;
+        _dirBytes[item._dir] += size;
+        _instructionCount[item._instruction]++;
+        _instructionBytes[item._instruction] += size;
+
+        if( item._instruction == CSYNC_INSTRUCTION_NEW ||
+            item._instruction == CSYNC_INSTRUCTION_SYNC ) {
+            if( item._size < 0 ) {
+                _unknownSize++;
+            } else if( item._size > 0 ) {
+                sized.append( item );
+            }
+        }
+    }
+
+    int n = qMin( sized.count(), PLAN_LARGEST_ITEMS );
+    std::partial_sort( sized.begin(), sized.begin() + n, sized.end(), largerThan );
+    sized.resize( n );
+    _largest = sized;
+}
+
+bool SyncPlan::isEmpty() const
+{
+    return _instructionCount.isEmpty();
+}
+
+int SyncPlan::fileCount( SyncFileItem::Direction dir ) const
+{
+    return _dirCount.value( dir, 0 );
+}
+
+qint64 SyncPlan::bytes( SyncFileItem::Direction dir ) const
+{
+    return _dirBytes.value( dir, 0 );
+}
+
+qint64 SyncPlan::totalBytes() const
+{
+    return bytes( SyncFileItem::Up ) + bytes( SyncFileItem::Down );
+}
+
+QList<int> SyncPlan::instructions() const
+{
+    QList<int> list = _instructionCount.keys();
+    qSort( list );
+    return list;
+}
+
+int SyncPlan::instructionCount( int instruction ) const
+{
+    return _instructionCount.value( instruction, 0 );
+}
+
+qint64 SyncPlan::instructionBytes( int instruction ) const
+{
+    return _instructionBytes.value( instruction, 0 );
+}
+
+int SyncPlan::unknownSizeCount() const
+{
+    return _unknownSize;
+}
+
+qint64 SyncPlan::estimatedDuration() const
+{
+    if( _throughput <= 0 ) return -1;
+    return totalBytes() * 1000 / _throughput;
+}
+
+SyncFileItemVector SyncPlan::largestItems() const
+{
+    return _largest;
+}
+
+QString SyncPlan::instructionName( int instruction )
+{
+    switch( instruction ) {
+    case CSYNC_INSTRUCTION_NONE:       return QLatin1String("none");
+    case CSYNC_INSTRUCTION_EVAL:       return QLatin1String("eval");
+    case CSYNC_INSTRUCTION_REMOVE:     return QLatin1String("remove");
+    case CSYNC_INSTRUCTION_RENAME:     return QLatin1String("rename");
+    case CSYNC_INSTRUCTION_NEW:        return QLatin1String("new");
+    case CSYNC_INSTRUCTION_CONFLICT:   return QLatin1String("conflict");
+    case CSYNC_INSTRUCTION_IGNORE:     return QLatin1String("ignore");
+    case CSYNC_INSTRUCTION_SYNC:       return QLatin1String("sync");
+    case CSYNC_INSTRUCTION_STAT_ERROR: return QLatin1String("stat error");
+    case CSYNC_INSTRUCTION_ERROR:      return QLatin1String("error");
+    case CSYNC_INSTRUCTION_DELETED:    return QLatin1String("deleted");
+    case CSYNC_INSTRUCTION_UPDATED:    return QLatin1String("updated");
+    default:
+        return QString::number( instruction );
+    }
+}
+
+QStringList SyncPlan::summary() const
+{
+    QStringList lines;
+
+    if( isEmpty() ) {
+        lines << QCoreApplication::translate("SyncPlan", "Nothing to sync.");
+        return lines;
+    }
+
+    lines << QCoreApplication::translate("SyncPlan", "Upload: %1 files, %2")
+             .arg( fileCount(SyncFileItem::Up) ).arg( Utility::octetsToString(bytes(SyncFileItem::Up)) );
+    lines << QCoreApplication::translate("SyncPlan", "Download: %1 files, %2")
+             .arg( fileCount(SyncFileItem::Down) ).arg( Utility::octetsToString(bytes(SyncFileItem::Down)) );
+    if( fileCount(SyncFileItem::None) > 0 ) {
+        lines << QCoreApplication::translate("SyncPlan", "Not transferred: %1 files")
+                 .arg( fileCount(SyncFileItem::None) );
+    }
+
+    foreach( int instruction, instructions() ) {
+        lines << QString::fromLatin1("  %1: %2 files, %3").arg( instructionName(instruction) )
+                 .arg( instructionCount(instruction) )
+                 .arg( Utility::octetsToString(instructionBytes(instruction)) );
+    }
+
+    if( _unknownSize > 0 ) {
+        lines << QCoreApplication::translate("SyncPlan", "The size of %1 files is only known once they are transferred.")
+                 .arg( _unknownSize );
+    }
+
+    qint64 msec = estimatedDuration();
+    if( msec < 0 ) {
+        lines << QCoreApplication::translate("SyncPlan", "Estimated duration: unknown, no earlier transfers were measured.");
+    } else {
+        lines << QCoreApplication::translate("SyncPlan", "Estimated duration: %1 minutes at %2/s")
+                 .arg( (msec + 59999) / 60000 ).arg( Utility::octetsToString(_throughput) );
+    }
+
+    if( !_largest.isEmpty() ) {
+        lines << QCoreApplication::translate("SyncPlan", "Largest files:");
+        foreach( const SyncFileItem& item, _largest ) {
+            lines << QString::fromLatin1("  %1 (%2)").arg( QDir::toNativeSeparators(item._file) )
+                     .arg( Utility::octetsToString(item._size) );
+        }
+    }
+    return lines;
+}
+
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) by agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef MIRALL_SYNCPLAN_H
+#define MIRALL_SYNCPLAN_H
+
+#include <QHash>
+#include <QStringList>
+
+#include "mirall/syncfileitem.h"
+
+namespace Mirall {
+
+/**
+ * Summary of what a sync run would do, computed from the items of the
+ * tree walks of a run which stopped before propagation.
+ */
+class SyncPlan
+{
+public:
+    SyncPlan();
+    /**
+     * throughput is the transfer rate in bytes per second seen in earlier
+     * runs, 0 if there is none yet.
+     */
+    SyncPlan( const SyncFileItemVector& items, qint64 throughput );
+
+    bool isEmpty() const;
+
+    int    fileCount( SyncFileItem::Direction ) const;
+    qint64 bytes( SyncFileItem::Direction ) const;
+    qint64 totalBytes() const;
+
+    QList<int> instructions() const;
+    int    instructionCount( int instruction ) const;
+    qint64 instructionBytes( int instruction ) const;
+
+    // files to transfer whose size is not known before the transfer
+    int unknownSizeCount() const;
+
+    // estimated transfer time in milliseconds, -1 if unknown
+    qint64 estimatedDuration() const;
+
+    // the biggest files to transfer, largest first
+    SyncFileItemVector largestItems() const;
+
+    // human readable report, one line per entry
+    QStringList summary() const;
+
+    static QString instructionName( int instruction );
+
+private:
+    QHash<int, int>    _dirCount;
+    QHash<int, qint64> _dirBytes;
+    QHash<int, int>    _instructionCount;
+    QHash<int, qint64> _instructionBytes;
+    int                _unknownSize;
+    qint64             _throughput;
+    SyncFileItemVector _largest;
+};
+
+}
+
+#endif // MIRALL_SYNCPLAN_H
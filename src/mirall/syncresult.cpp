@@ -18,12 +18,22 @@ namespace Mirall
 {
 
 SyncResult::SyncResult()
-: _status( Undefined )
+: _status( Undefined ),
+  _transferredFiles(0),
+  _uploadedBytes(0),
+  _downloadedBytes(0),
+  _pollInterval(0),
+  _deferredBytes(0)
 {
 }
 
 SyncResult::SyncResult(SyncResult::Status status )
-    : _status(status)
+    : _status(status),
+      _transferredFiles(0),
+      _uploadedBytes(0),
+      _downloadedBytes(0),
+      _pollInterval(0),
+      _deferredBytes(0)
 {
 }
 
@@ -62,6 +72,12 @@ QString SyncResult::statusString() const
         case Unavailable:
             re = QLatin1String("Not availabe");
             break;
+        case Deferred:
+            re = QLatin1String("Deferred");
+            break;
+        case Planned:
+            re = QLatin1String("Planned");
+            break;
     }
     return re;
 }
@@ -87,6 +103,128 @@ QDateTime SyncResult::syncTime() const
     return _syncTime;
 }
 
+void SyncResult::setPhaseTime( const QString& phase, int msec )
+{
+    _phaseTimes[phase] = msec;
+}
+
+int SyncResult::phaseTime( const QString& phase ) const
+{
+    return _phaseTimes.value( phase, 0 );
+}
+
+QHash<QString, int> SyncResult::phaseTimes() const
+{
+    return _phaseTimes;
+}
+
+void SyncResult::clearPhaseTimes()
+{
+    _phaseTimes.clear();
+}
+
+void SyncResult::setMemoryUsage( const QHash<QString, qint64>& usage )
+{
+    _memoryUsage = usage;
+}
+
+QHash<QString, qint64> SyncResult::memoryUsage() const
+{
+    return _memoryUsage;
+}
+
+void SyncResult::setTransferred( int files, qint64 uploadedBytes, qint64 downloadedBytes )
+{
+    _transferredFiles = files;
+    _uploadedBytes = uploadedBytes;
+    _downloadedBytes = downloadedBytes;
+}
+
+int SyncResult::transferredFiles() const
+{
+    return _transferredFiles;
+}
+
+qint64 SyncResult::transferredBytes() const
+{
+    return _uploadedBytes + _downloadedBytes;
+}
+
+qint64 SyncResult::uploadedBytes() const
+{
+    return _uploadedBytes;
+}
+
+qint64 SyncResult::downloadedBytes() const
+{
+    return _downloadedBytes;
+}
+
+// the rates are averaged over the whole propagation phase, which
+// includes requests that do not transfer any data.
+qint64 SyncResult::throughput() const
+{
+    int msec = phaseTime( QLatin1String("propagate") );
+    if( msec <= 0 ) return 0;
+    return transferredBytes() * 1000 / msec;
+}
+
+qint64 SyncResult::uploadRate() const
+{
+    int msec = phaseTime( QLatin1String("propagate") );
+    if( msec <= 0 ) return 0;
+    return _uploadedBytes * 1000 / msec;
+}
+
+qint64 SyncResult::downloadRate() const
+{
+    int msec = phaseTime( QLatin1String("propagate") );
+    if( msec <= 0 ) return 0;
+    return _downloadedBytes * 1000 / msec;
+}
+
+void SyncResult::setPollInterval( int msec, const QString& reason )
+{
+    _pollInterval = msec;
+    _pollIntervalReason = reason;
+}
+
+int SyncResult::pollInterval() const
+{
+    return _pollInterval;
+}
+
+QString SyncResult::pollIntervalReason() const
+{
+    return _pollIntervalReason;
+}
+
+void SyncResult::setDeferred( qint64 plannedBytes, const QTime& until )
+{
+    _deferredBytes = plannedBytes;
+    _deferredUntil = until;
+}
+
+qint64 SyncResult::deferredBytes() const
+{
+    return _deferredBytes;
+}
+
+QTime SyncResult::deferredUntil() const
+{
+    return _deferredUntil;
+}
+
+void SyncResult::setPlan( const SyncPlan& plan )
+{
+    _plan = plan;
+}
+
+SyncPlan SyncResult::plan() const
+{
+    return _plan;
+}
+
 void SyncResult::setErrorStrings( const QStringList& list )
 {
     _errors = list;
@@ -20,6 +20,7 @@
 #include <QDateTime>
 
 #include "mirall/syncfileitem.h"
+#include "mirall/syncplan.h"
 
 namespace Mirall
 {
@@ -36,7 +37,9 @@ public:
       Success,
       Error,
       SetupError,
-      Unavailable
+      Unavailable,
+      Deferred,
+      Planned
     };
 
     SyncResult();
@@ -57,10 +60,58 @@ public:
     QString statusString() const;
     QDateTime syncTime() const;
 
+    // duration of the csync phases of the last run in milliseconds,
+    // keyed by phase name (update, reconcile, propagate, commit).
+    void setPhaseTime( const QString&, int );
+    int  phaseTime( const QString& ) const;
+    QHash<QString, int> phaseTimes() const;
+    void clearPhaseTimes();
+
+    // approximate bytes the folder holds per component after the last
+    // run, see MemoryUsage.
+    void setMemoryUsage( const QHash<QString, qint64>& );
+    QHash<QString, qint64> memoryUsage() const;
+
+    // files and bytes transferred by the last run, also if it was interrupted.
+    void setTransferred( int files, qint64 uploadedBytes, qint64 downloadedBytes );
+    int transferredFiles() const;
+    qint64 transferredBytes() const;
+    qint64 uploadedBytes() const;
+    qint64 downloadedBytes() const;
+    // bytes per second during the propagation phase, 0 if unknown.
+    qint64 throughput() const;
+    qint64 uploadRate() const;
+    qint64 downloadRate() const;
+
+    // the poll interval used after this run and why it was chosen.
+    void setPollInterval( int msec, const QString& reason );
+    int pollInterval() const;
+    QString pollIntervalReason() const;
+
+    // planned transfer size of a run that was deferred to the transfer
+    // window, and the time the window opens.
+    void setDeferred( qint64 plannedBytes, const QTime& until );
+    qint64 deferredBytes() const;
+    QTime deferredUntil() const;
+
+    // result of the last plan-only run
+    void setPlan( const SyncPlan& );
+    SyncPlan plan() const;
+
 private:
     Status             _status;
     SyncFileItemVector _syncItems;
     QDateTime          _syncTime;
+    QHash<QString, int> _phaseTimes;
+    QHash<QString, qint64> _memoryUsage;
+    int                _transferredFiles;
+    qint64             _uploadedBytes;
+    qint64             _downloadedBytes;
+    int                _pollInterval;
+    QString            _pollIntervalReason;
+    qint64             _deferredBytes;
+    QTime              _deferredUntil;
+    SyncPlan           _plan;
     /**
      * when the sync tool support this...
      */
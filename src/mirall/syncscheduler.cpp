@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) by agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include "mirall/syncscheduler.h"
+
+#include <QDebug>
+
+/* waiting time after which a queued folder climbs one reason level */
+#define DEFAULT_AGING_INTERVAL_MSEC 60000
+
+namespace Mirall {
+
+SyncScheduler::SyncScheduler()
+    : _agingInterval(DEFAULT_AGING_INTERVAL_MSEC),
+      _lastWait(0),
+      _maxWait(0),
+      _totalWait(0),
+      _served(0)
+{
+}
+
+int SyncScheduler::indexOf( const QString& alias ) const
+{
+    for( int i = 0; i < _queue.count(); i++ ) {
+        if( _queue.at(i)._alias == alias ) return i;
+    }
+    return -1;
+}
+
+void SyncScheduler::enqueue( const QString& alias, Folder::SyncReason reason,
+                             double weight, qint64 nowMsec )
+{
+    if( alias.isEmpty() ) return;
+    if( weight <= 0.0 ) weight = 1.0;
+
+    int indx = indexOf( alias );
+    if( indx > -1 ) {
+        Entry& e = _queue[indx];
+        if( reason > e._reason ) {
+            qDebug() << " II> Sync for folder " << alias << " already scheduled, raising priority to" << reason;
+            e._reason = reason;
+        }
+        e._weight = weight;
+        return;
+    }
+
+    Entry e;
+    e._alias    = alias;
+    e._reason   = reason;
+    e._weight   = weight;
+    e._enqueued = nowMsec;
+    _queue.append(e);
+}
+
+double SyncScheduler::rank( const Entry& e, qint64 nowMsec ) const
+{
+    qint64 waited = qMax( qint64(0), nowMsec - e._enqueued );
+    return double(e._reason) + e._weight * double(waited) / double(_agingInterval);
+}
+
+QString SyncScheduler::takeNext( qint64 nowMsec )
+{
+    if( _queue.isEmpty() ) return QString::null;
+
+    // the queue holds one entry per folder, a linear scan is cheap enough.
+    int best = 0;
+    double bestRank = rank( _queue.at(0), nowMsec );
+    for( int i = 1; i < _queue.count(); i++ ) {
+        double r = rank( _queue.at(i), nowMsec );
+        if( r > bestRank ) {
+            best = i;
+            bestRank = r;
+        }
+    }
+
+    Entry e = _queue.takeAt(best);
+    _lastWait = qMax( qint64(0), nowMsec - e._enqueued );
+    _maxWait = qMax( _maxWait, _lastWait );
+    _totalWait += _lastWait;
+    _served++;
+
+    qDebug() << "Scheduler picked" << e._alias << "reason" << e._reason
+             << "waited" << _lastWait << "msec," << _queue.count() << "folders left in queue";
+    return e._alias;
+}
+
+void SyncScheduler::remove( const QString& alias )
+{
+    int indx = indexOf( alias );
+    if( indx > -1 ) {
+        _queue.removeAt( indx );
+    }
+}
+
+void SyncScheduler::clear()
+{
+    _queue.clear();
+}
+
+bool SyncScheduler::contains( const QString& alias ) const
+{
+    return indexOf( alias ) > -1;
+}
+
+int SyncScheduler::depth() const
+{
+    return _queue.count();
+}
+
+QStringList SyncScheduler::aliases() const
+{
+    QStringList list;
+    foreach( const Entry& e, _queue ) {
+        list.append( e._alias );
+    }
+    return list;
+}
+
+qint64 SyncScheduler::lastWaitTime() const
+{
+    return _lastWait;
+}
+
+qint64 SyncScheduler::maxWaitTime() const
+{
+    return _maxWait;
+}
+
+qint64 SyncScheduler::averageWaitTime() const
+{
+    if( _served == 0 ) return 0;
+    return _totalWait / _served;
+}
+
+void SyncScheduler::setAgingInterval( qint64 msec )
+{
+    if( msec > 0 ) {
+        _agingInterval = msec;
+    }
+}
+
+qint64 SyncScheduler::agingInterval() const
+{
+    return _agingInterval;
+}
+
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) by agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef MIRALL_SYNCSCHEDULER_H
+#define MIRALL_SYNCSCHEDULER_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+
+#include "mirall/folder.h"
+
+namespace Mirall {
+
+/**
+ * Decides which of the folders that want to sync goes next.
+ *
+ * Every entry carries the reason why the folder asked for a sync. Local
+ * changes outrank remote changes, which outrank periodic polls. The time an
+ * entry has been waiting, multiplied by the folder weight, is added to its
+ * rank so that a low priority folder can not starve forever.
+ *
+ * The scheduler does not read the clock itself, the caller passes the
+ * current time in milliseconds. That keeps it usable with a virtual clock.
+ */
+class SyncScheduler
+{
+public:
+    SyncScheduler();
+
+    /**
+     * Adds a folder to the queue. If it is already queued, the entry keeps
+     * its original enqueue time and is upgraded to the more urgent reason.
+     */
+    void enqueue( const QString& alias, Folder::SyncReason reason,
+                  double weight, qint64 nowMsec );
+
+    /**
+     * Removes and returns the alias with the highest rank, or an empty
+     * string if the queue is empty.
+     */
+    QString takeNext( qint64 nowMsec );
+
+    void remove( const QString& alias );
+    void clear();
+    bool contains( const QString& alias ) const;
+
+    int depth() const;
+    QStringList aliases() const;
+
+    /**
+     * statistics about the entries that were taken from the queue.
+     */
+    qint64 lastWaitTime() const;
+    qint64 maxWaitTime() const;
+    qint64 averageWaitTime() const;
+
+    /**
+     * The waiting time after which an entry climbs one reason level.
+     */
+    void setAgingInterval( qint64 msec );
+    qint64 agingInterval() const;
+
+private:
+    struct Entry {
+        QString            _alias;
+        Folder::SyncReason _reason;
+        double             _weight;
+        qint64             _enqueued;
+    };
+
+    double rank( const Entry&, qint64 nowMsec ) const;
+    int indexOf( const QString& alias ) const;
+
+    QList<Entry> _queue;
+    qint64       _agingInterval;
+    qint64       _lastWait;
+    qint64       _maxWait;
+    qint64       _totalWait;
+    qint64       _served;
+};
+
+}
+
+#endif // MIRALL_SYNCSCHEDULER_H
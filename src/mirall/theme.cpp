@@ -64,6 +64,12 @@ QString Theme::statusHeaderText( SyncResult::Status status ) const
     case SyncResult::SetupError:
         resultStr = QObject::tr( "Setup Error" );
         break;
+    case SyncResult::Deferred:
+        resultStr = QObject::tr( "Large transfer waits for the transfer window" );
+        break;
+    case SyncResult::Planned:
+        resultStr = QObject::tr( "Sync plan ready - Click info button for details." );
+        break;
     default:
         resultStr = QObject::tr("Status undefined");
     }
@@ -214,6 +220,8 @@ QIcon Theme::syncStateIcon( SyncResult::Status status, bool sysTray ) const
         break;
     case SyncResult::SyncPrepare:
     case SyncResult::Success:
+    case SyncResult::Deferred:
+    case SyncResult::Planned:
         statusIcon = QLatin1String("state-ok");
         break;
     case SyncResult::Error:
@@ -15,7 +15,7 @@
 
 #include "mirall/version.h"
 
-#include <QCoreApplication>
+#include <QApplication>
 #include <QDir>
 #include <QFile>
 #include <QUrl>
@@ -125,4 +125,25 @@ QByteArray Utility::userAgentString()
             .toLatin1();
 }
 
+QString Utility::octetsToString( qint64 octets )
+{
+    static const qint64 kb = 1024;
+    static const qint64 mb = 1024 * kb;
+    static const qint64 gb = 1024 * mb;
+
+    if( octets >= gb ) {
+        return QString::fromLatin1("%1 GB").arg( double(octets)/gb, 0, 'f', 1 );
+    } else if( octets >= mb ) {
+        return QString::fromLatin1("%1 MB").arg( double(octets)/mb, 0, 'f', 1 );
+    } else if( octets >= kb ) {
+        return QString::fromLatin1("%1 kB").arg( octets/kb );
+    }
+    return QString::fromLatin1("%1 B").arg( octets );
+}
+
+bool Utility::hasGui()
+{
+    return qobject_cast<QApplication*>( QCoreApplication::instance() ) != 0;
+}
+
 } // namespace Mirall
@@ -27,6 +27,9 @@ public:
     static void setupFavLink( const QString &folder );
     static QString platform();
     static QByteArray userAgentString();
+    static QString octetsToString( qint64 octets );
+    // false if running without a QApplication, e.g. in the sync daemon
+    static bool hasGui();
 };
 
 }
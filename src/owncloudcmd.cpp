@@ -0,0 +1,441 @@
+/*
+ * Copyright (C) by agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include <iostream>
+#include <stdio.h>
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+#include <QTime>
+#include <QUrl>
+#include <QDir>
+#include <QDebug>
+#include <QNetworkProxy>
+#include <QNetworkProxyFactory>
+
+#include <csync.h>
+
+#include "owncloudcmd.h"
+#include "mirall/csyncthread.h"
+#include "mirall/mirallconfigfile.h"
+#include "mirall/owncloudfolder.h"
+#include "mirall/syncplan.h"
+
+/* exit codes of the command line client */
+#define EXIT_SYNC_OK      0
+#define EXIT_SYNC_ERROR   1
+#define EXIT_USAGE        2
+#define EXIT_UNAVAILABLE  3
+#define EXIT_REMOVE_ALL   4
+
+namespace {
+
+static const char usageC[] =
+        "Usage: owncloudcmd [options] <localdir> <url>\n"
+        "Syncs <localdir> once with the WebDAV folder at <url> and prints\n"
+        "the statistics of the run as JSON.\n\n"
+        "Options:\n"
+        "  -h --help            : show this help screen.\n"
+        "  --user <name>        : user name, also taken from the url.\n"
+        "  --password <pwd>     : password, also taken from the url.\n"
+        "  --confdir <dirname>  : Use the given configuration directory.\n"
+        "  --exclude <file>     : exclude list, default is the one of the client.\n"
+        "  --plan               : only report what would be synced.\n"
+        "  --allow-remove-all   : sync also if all files would be removed.\n"
+        "  --trust              : accept the SSL certificate of the server.\n"
+        "  --verbose            : print the log output to stderr.\n"
+        ;
+
+bool verbose = false;
+bool trustSsl = false;
+QByteArray authUser;
+QByteArray authPassword;
+
+void messageHandler( QtMsgType type, const char *msg )
+{
+    if( type == QtDebugMsg && !verbose ) return;
+    fprintf( stderr, "%s\n", msg );
+}
+
+void csyncLogCatcher( CSYNC *ctx, int verbosity, const char *function,
+                      const char *buffer, void *userdata )
+{
+    Q_UNUSED(ctx); Q_UNUSED(verbosity); Q_UNUSED(function); Q_UNUSED(userdata);
+    if( verbose ) {
+        fprintf( stderr, "%s\n", buffer );
+    }
+}
+
+int getauth( const char *prompt, char *buf, size_t len,
+             int echo, int verify, void *userdata )
+{
+    Q_UNUSED(echo); Q_UNUSED(verify); Q_UNUSED(userdata);
+
+    QString qPrompt = QString::fromLatin1( prompt ).trimmed();
+
+    if( qPrompt == QLatin1String("Enter your username:") ) {
+        qstrncpy( buf, authUser.constData(), len );
+    } else if( qPrompt == QLatin1String("Enter your password:") ) {
+        qstrncpy( buf, authPassword.constData(), len );
+    } else if( qPrompt.startsWith( QLatin1String("There are problems with the SSL certificate:") ) ) {
+        // there is no user to ask, the certificate has to be trusted upfront.
+        qstrncpy( buf, trustSsl ? "yes" : "no", len );
+        return trustSsl ? 0 : -1;
+    } else {
+        qDebug() << "Unknown prompt: <" << prompt << ">";
+        return -1;
+    }
+    return 0;
+}
+
+QString jsonString( const QString& str )
+{
+    QString re;
+    re.reserve( str.length() + 2 );
+    re.append( QLatin1Char('"') );
+    foreach( const QChar& c, str ) {
+        switch( c.unicode() ) {
+        case '"':  re.append( QLatin1String("\\\"") ); break;
+        case '\\': re.append( QLatin1String("\\\\") ); break;
+        case '\n': re.append( QLatin1String("\\n") ); break;
+        case '\r': re.append( QLatin1String("\\r") ); break;
+        case '\t': re.append( QLatin1String("\\t") ); break;
+        default:
+            if( c.unicode() < 0x20 ) {
+                re.append( QString::fromLatin1("\\u%1").arg( c.unicode(), 4, 16, QLatin1Char('0') ) );
+            } else {
+                re.append( c );
+            }
+        }
+    }
+    re.append( QLatin1Char('"') );
+    return re;
+}
+
+void writeJson( QTextStream& out, const Mirall::SyncResult& result, int exitCode,
+                int msec, bool plan )
+{
+    out << "{\n";
+    out << "  \"status\": " << jsonString( result.statusString() ) << ",\n";
+    out << "  \"exitCode\": " << exitCode << ",\n";
+    out << "  \"durationMsec\": " << msec << ",\n";
+
+    out << "  \"phases\": {";
+    QHash<QString, int> phases = result.phaseTimes();
+    QStringList names = phases.keys();
+    for( int i = 0; i < names.count(); i++ ) {
+        out << (i ? ", " : " ") << jsonString( names.at(i) ) << ": " << phases.value( names.at(i) );
+    }
+    out << " },\n";
+
+    out << "  \"items\": " << result.syncFileItemVector().count() << ",\n";
+    out << "  \"transferredFiles\": " << result.transferredFiles() << ",\n";
+    out << "  \"uploadedBytes\": " << result.uploadedBytes() << ",\n";
+    out << "  \"downloadedBytes\": " << result.downloadedBytes() << ",\n";
+    out << "  \"throughput\": " << result.throughput() << ",\n";
+
+    if( plan ) {
+        Mirall::SyncPlan p = result.plan();
+        out << "  \"plan\": {\n";
+        out << "    \"uploadFiles\": " << p.fileCount( Mirall::SyncFileItem::Up ) << ",\n";
+        out << "    \"uploadBytes\": " << p.bytes( Mirall::SyncFileItem::Up ) << ",\n";
+        out << "    \"downloadFiles\": " << p.fileCount( Mirall::SyncFileItem::Down ) << ",\n";
+        out << "    \"downloadBytes\": " << p.bytes( Mirall::SyncFileItem::Down ) << ",\n";
+        out << "    \"unknownSize\": " << p.unknownSizeCount() << ",\n";
+        out << "    \"estimatedMsec\": " << p.estimatedDuration() << ",\n";
+        out << "    \"instructions\": {";
+        QList<int> instructions = p.instructions();
+        for( int i = 0; i < instructions.count(); i++ ) {
+            int instr = instructions.at(i);
+            out << (i ? ", " : " ") << jsonString( Mirall::SyncPlan::instructionName(instr) )
+                << ": { \"files\": " << p.instructionCount(instr)
+                << ", \"bytes\": " << p.instructionBytes(instr) << " }";
+        }
+        out << " },\n";
+        out << "    \"largest\": [";
+        Mirall::SyncFileItemVector largest = p.largestItems();
+        for( int i = 0; i < largest.count(); i++ ) {
+            out << (i ? ", " : " ") << "{ \"file\": " << jsonString( largest.at(i)._file )
+                << ", \"bytes\": " << largest.at(i)._size << " }";
+        }
+        out << " ]\n";
+        out << "  },\n";
+    }
+
+    out << "  \"errors\": [";
+    QStringList errors = result.errorStrings();
+    for( int i = 0; i < errors.count(); i++ ) {
+        out << (i ? ", " : " ") << jsonString( errors.at(i) );
+    }
+    out << " ]\n";
+    out << "}\n";
+}
+
+QString replaceScheme( const QUrl& url )
+{
+    QUrl re( url );
+    if( url.scheme() == QLatin1String("https") ) {
+        re.setScheme( QLatin1String("ownclouds") );
+    } else {
+        re.setScheme( QLatin1String("owncloud") );
+    }
+    // the credentials are passed through the auth callback
+    re.setUserInfo( QString::null );
+    return re.toString();
+}
+
+// the proxy of the config file, like the client and the daemon set it up
+QNetworkProxy proxyFor( const Mirall::MirallConfigFile& cfg, const QUrl& url )
+{
+    QNetworkProxy proxy;
+    proxy.setHostName( cfg.proxyHostName() );
+    proxy.setPort( cfg.proxyPort() );
+    if( cfg.proxyNeedsAuth() ) {
+        proxy.setUser( cfg.proxyUser() );
+        proxy.setPassword( cfg.proxyPassword() );
+    }
+
+    switch( cfg.proxyType() ) {
+    case QNetworkProxy::NoProxy:
+        QNetworkProxy::setApplicationProxy(QNetworkProxy::NoProxy);
+        break;
+    case QNetworkProxy::DefaultProxy:
+        QNetworkProxyFactory::setUseSystemConfiguration(true);
+        break;
+    case QNetworkProxy::Socks5Proxy:
+        proxy.setType(QNetworkProxy::Socks5Proxy);
+        QNetworkProxy::setApplicationProxy(proxy);
+        break;
+    case QNetworkProxy::HttpProxy:
+        proxy.setType(QNetworkProxy::HttpProxy);
+        QNetworkProxy::setApplicationProxy(proxy);
+        break;
+    default:
+        break;
+    }
+
+    QList<QNetworkProxy> proxies = QNetworkProxyFactory::proxyForQuery( QNetworkProxyQuery(url) );
+    return proxies.isEmpty() ? QNetworkProxy( QNetworkProxy::NoProxy ) : proxies.first();
+}
+
+}
+
+namespace Mirall {
+
+CmdSyncObserver::CmdSyncObserver( bool allowRemoveAll, QObject *parent )
+    : QObject( parent ),
+      _result( SyncResult::NotYetStarted ),
+      _allowRemoveAll( allowRemoveAll ),
+      _unavailable( false ),
+      _removeAllRefused( false )
+{
+}
+
+SyncResult CmdSyncObserver::result() const
+{
+    return _result;
+}
+
+bool CmdSyncObserver::unavailable() const
+{
+    return _unavailable;
+}
+
+bool CmdSyncObserver::removeAllRefused() const
+{
+    return _removeAllRefused;
+}
+
+void CmdSyncObserver::slotCSyncError( const QString& err )
+{
+    _result.setErrorString( err );
+}
+
+void CmdSyncObserver::slotCSyncUnavailable()
+{
+    _unavailable = true;
+}
+
+void CmdSyncObserver::slotPhaseTime( const QString& phase, int msec )
+{
+    _result.setPhaseTime( phase, msec );
+}
+
+void CmdSyncObserver::slotTransferProgress( int files, qint64 uploaded, qint64 downloaded )
+{
+    _result.setTransferred( files, uploaded, downloaded );
+}
+
+void CmdSyncObserver::slotTreeWalkResult( const SyncFileItemVector& items )
+{
+    _result.setSyncFileItemVector( items );
+}
+
+void CmdSyncObserver::slotAboutToRemoveAllFiles( SyncFileItem::Direction, bool *cancel )
+{
+    *cancel = !_allowRemoveAll;
+    if( *cancel ) {
+        _removeAllRefused = true;
+        _result.setErrorString( QLatin1String("The sync would remove all files, "
+                                              "use --allow-remove-all to sync anyway.") );
+    }
+}
+
+}
+
+using namespace Mirall;
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    qInstallMsgHandler( messageHandler );
+
+    QStringList args = app.arguments();
+    QStringList positional;
+    QString user, password, confDir, excludeFile;
+    bool planOnly = false;
+    bool allowRemoveAll = false;
+
+    for( int i = 1; i < args.count(); i++ ) {
+        const QString option = args.at(i);
+        bool hasValue = i+1 < args.count();
+
+        if( option == QLatin1String("-h") || option == QLatin1String("--help") ) {
+            std::cout << usageC;
+            return EXIT_SYNC_OK;
+        } else if( option == QLatin1String("--user") && hasValue ) {
+            user = args.at(++i);
+        } else if( option == QLatin1String("--password") && hasValue ) {
+            password = args.at(++i);
+        } else if( option == QLatin1String("--confdir") && hasValue ) {
+            confDir = args.at(++i);
+        } else if( option == QLatin1String("--exclude") && hasValue ) {
+            excludeFile = args.at(++i);
+        } else if( option == QLatin1String("--plan") ) {
+            planOnly = true;
+        } else if( option == QLatin1String("--allow-remove-all") ) {
+            allowRemoveAll = true;
+        } else if( option == QLatin1String("--trust") ) {
+            trustSsl = true;
+        } else if( option == QLatin1String("--verbose") ) {
+            verbose = true;
+        } else if( option.startsWith( QLatin1String("--") ) ) {
+            std::cerr << usageC;
+            return EXIT_USAGE;
+        } else {
+            positional.append( option );
+        }
+    }
+
+    if( positional.count() != 2 ) {
+        std::cerr << usageC;
+        return EXIT_USAGE;
+    }
+
+    QString localDir = QDir( positional.at(0) ).absolutePath();
+    QUrl url( positional.at(1) );
+    if( !url.isValid() || url.host().isEmpty() ) {
+        std::cerr << "Invalid url: " << qPrintable( positional.at(1) ) << std::endl;
+        return EXIT_USAGE;
+    }
+    authUser     = (user.isEmpty() ? url.userName() : user).toUtf8();
+    authPassword = (password.isEmpty() ? url.password() : password).toUtf8();
+
+    if( !confDir.isEmpty() ) {
+        MirallConfigFile::setConfDir( confDir );
+    }
+    MirallConfigFile cfg;
+    if( excludeFile.isEmpty() ) {
+        excludeFile = cfg.excludeFile();
+    }
+
+    QTime t;
+    t.start();
+
+    SyncResult result;
+    int exitCode = EXIT_SYNC_OK;
+
+    CSYNC *ctx = 0;
+    QString remote = replaceScheme( url );
+    if( csync_create( &ctx, localDir.toUtf8().data(), remote.toUtf8().data() ) < 0 ) {
+        result.setErrorString( QLatin1String("Unable to create csync-context") );
+        result.setStatus( SyncResult::SetupError );
+        exitCode = EXIT_SYNC_ERROR;
+    } else {
+        csync_set_log_callback( ctx, csyncLogCatcher );
+        csync_set_log_verbosity( ctx, verbose ? 11 : 0 );
+        csync_set_config_dir( ctx, cfg.configPath().toUtf8() );
+        csync_enable_conflictcopys( ctx );
+        if( !excludeFile.isEmpty() ) {
+            csync_add_exclude_list( ctx, excludeFile.toUtf8() );
+        }
+        csync_set_auth_callback( ctx, getauth );
+
+        if( csync_init( ctx ) < 0 ) {
+            result.setErrorString( CSyncThread::csyncErrorToString( csync_get_error(ctx),
+                                                                    csync_get_error_string(ctx) ) );
+            result.setStatus( SyncResult::SetupError );
+            exitCode = EXIT_SYNC_ERROR;
+        } else {
+            // the same proxy, chunking and bandwidth limits as the client
+            ownCloudFolder::setModuleProxy( ctx, proxyFor( cfg, url ) );
+            ownCloudFolder::setModuleTransferOptions( ctx );
+
+            // no event loop needed, the run happens in this thread and
+            // all signals are delivered directly.
+            CSyncThread csyncThread( ctx );
+            csyncThread.setLocalPath( localDir );
+            csyncThread.setPlanOnly( planOnly );
+
+            CmdSyncObserver observer( allowRemoveAll );
+            QObject::connect( &csyncThread, SIGNAL(csyncError(QString)),
+                              &observer, SLOT(slotCSyncError(QString)) );
+            QObject::connect( &csyncThread, SIGNAL(csyncUnavailable()),
+                              &observer, SLOT(slotCSyncUnavailable()) );
+            QObject::connect( &csyncThread, SIGNAL(phaseTime(QString,int)),
+                              &observer, SLOT(slotPhaseTime(QString,int)) );
+            QObject::connect( &csyncThread, SIGNAL(transferProgress(int,qint64,qint64)),
+                              &observer, SLOT(slotTransferProgress(int,qint64,qint64)) );
+            QObject::connect( &csyncThread, SIGNAL(treeWalkResult(SyncFileItemVector)),
+                              &observer, SLOT(slotTreeWalkResult(SyncFileItemVector)) );
+            QObject::connect( &csyncThread, SIGNAL(aboutToRemoveAllFiles(SyncFileItem::Direction,bool*)),
+                              &observer, SLOT(slotAboutToRemoveAllFiles(SyncFileItem::Direction,bool*)) );
+
+            csyncThread.startSync();
+            result = observer.result();
+
+            if( observer.removeAllRefused() ) {
+                result.setStatus( SyncResult::Error );
+                exitCode = EXIT_REMOVE_ALL;
+            } else if( !result.errorStrings().isEmpty() ) {
+                result.setStatus( SyncResult::Error );
+                exitCode = EXIT_SYNC_ERROR;
+            } else if( observer.unavailable() ) {
+                result.setStatus( SyncResult::Unavailable );
+                exitCode = EXIT_UNAVAILABLE;
+            } else if( planOnly ) {
+                result.setPlan( SyncPlan( result.syncFileItemVector(), cfg.measuredThroughput() ) );
+                result.setStatus( SyncResult::Planned );
+            } else {
+                result.setStatus( SyncResult::Success );
+            }
+        }
+        csync_destroy( ctx );
+    }
+
+    QTextStream out( stdout );
+    writeJson( out, result, exitCode, t.elapsed(), planOnly && exitCode == EXIT_SYNC_OK );
+    return exitCode;
+}
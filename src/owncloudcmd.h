@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) by agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef OWNCLOUDCMD_H
+#define OWNCLOUDCMD_H
+
+#include <QObject>
+
+#include "mirall/syncresult.h"
+#include "mirall/syncfileitem.h"
+
+namespace Mirall {
+
+/**
+ * Collects the signals of one CSyncThread run of the command line
+ * client into a SyncResult.
+ */
+class CmdSyncObserver : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CmdSyncObserver( bool allowRemoveAll, QObject *parent = 0 );
+
+    SyncResult result() const;
+    bool unavailable() const;
+    bool removeAllRefused() const;
+
+public slots:
+    void slotCSyncError( const QString& );
+    void slotCSyncUnavailable();
+    void slotPhaseTime( const QString&, int );
+    void slotTransferProgress( int, qint64, qint64 );
+    void slotTreeWalkResult( const SyncFileItemVector& );
+    void slotAboutToRemoveAllFiles( SyncFileItem::Direction, bool* );
+
+private:
+    SyncResult _result;
+    bool       _allowRemoveAll;
+    bool       _unavailable;
+    bool       _removeAllRefused;
+};
+
+}
+
+#endif // OWNCLOUDCMD_H
@@ -0,0 +1,648 @@
+/*
+ * Copyright (C) by agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#include <iostream>
+#include <stdio.h>
+
+#include <QCoreApplication>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QNetworkProxy>
+#include <QNetworkProxyFactory>
+#include <QNetworkReply>
+#include <QTimer>
+#include <QDir>
+#include <QDebug>
+
+#include "owncloudd.h"
+#include "qtlockedfile.h"
+#include "mirall/folderman.h"
+#include "mirall/folder.h"
+#include "mirall/mirallconfigfile.h"
+#include "mirall/owncloudinfo.h"
+#include "mirall/credentialstore.h"
+#include "mirall/logger.h"
+#include "mirall/theme.h"
+#include "mirall/syncresult.h"
+#include "mirall/utility.h"
+#include "mirall/memoryusage.h"
+
+/* exit codes of the sync daemon */
+#define EXIT_DAEMON_OK     0
+#define EXIT_DAEMON_ERROR  1
+#define EXIT_USAGE         2
+#define EXIT_NO_DAEMON     3
+
+/* milliseconds the control client waits for the daemon to answer */
+#define CONTROL_TIMEOUT_MSEC 10000
+
+/* seconds until the server is looked up again if it was not found */
+#define SERVER_RETRY_SEC 30
+
+namespace {
+
+static const char usageC[] =
+        "Usage: owncloudd [options]\n"
+        "Runs the configured sync folders without a graphical interface.\n\n"
+        "Options:\n"
+        "  -h --help            : show this help screen.\n"
+        "  --confdir <dirname>  : Use the given configuration directory.\n"
+        "  --socket <name>      : name of the control socket.\n"
+        "  --logfile <filename> : write log output to file <filename>.\n"
+        "  --logflush           : flush the log file after every write.\n"
+        "  --verbose            : write the log output to stderr.\n"
+        "  --control <command>  : send <command> to the running daemon\n"
+        "                         and print its answer. Commands are\n"
+        "                         status, sync, pause, resume, plan,\n"
+        "                         limit, reconnect, quit and help.\n"
+        ;
+
+static const char commandsC[] =
+        "status            : state of the connection and of all folders\n"
+        "sync [alias]      : sync the folder, or all folders, now\n"
+        "pause [alias]     : pause the folder, or start no more syncs at all\n"
+        "resume [alias]    : resume the folder, or syncing in general\n"
+        "plan <alias>      : plan the next sync of the folder, see status\n"
+        "limit up|down <n> : limit the bandwidth to n KB/s, or n% of the\n"
+        "                    measured capacity with n%, 0 for no limit\n"
+        "reconnect         : check the server and the credentials again\n"
+        "quit              : stop the running sync and exit\n"
+        ;
+
+bool logging = false;
+
+void messageHandler( QtMsgType type, const char *msg )
+{
+    if( !logging ) {
+        if( type != QtDebugMsg ) fprintf( stderr, "%s\n", msg );
+        return;
+    }
+    // qDebug() exports to local8Bit, which is not always UTF-8
+    Mirall::Logger::instance()->mirallLog( QString::fromLocal8Bit(msg) );
+}
+
+int sendControlCommand( const QString& socketName, const QString& command )
+{
+    QLocalSocket socket;
+    socket.connectToServer( socketName );
+    if( !socket.waitForConnected( CONTROL_TIMEOUT_MSEC ) ) {
+        std::cerr << "No sync daemon listens on " << qPrintable(socketName) << std::endl;
+        return EXIT_NO_DAEMON;
+    }
+
+    socket.write( command.toUtf8() + '\n' );
+    socket.flush();
+
+    forever {
+        while( !socket.canReadLine() ) {
+            if( !socket.waitForReadyRead( CONTROL_TIMEOUT_MSEC ) ) {
+                std::cerr << "The sync daemon did not answer." << std::endl;
+                return EXIT_DAEMON_ERROR;
+            }
+        }
+        QString line = QString::fromUtf8( socket.readLine() ).trimmed();
+        std::cout << qPrintable(line) << std::endl;
+        if( line.startsWith( QLatin1String("OK") ) ) {
+            return EXIT_DAEMON_OK;
+        } else if( line.startsWith( QLatin1String("ERROR") ) ) {
+            return EXIT_DAEMON_ERROR;
+        }
+    }
+}
+
+}
+
+namespace Mirall {
+
+SyncDaemon::SyncDaemon( const QString& socketName, QObject *parent )
+    : QObject(parent),
+      _folderMan(0),
+      _server(0),
+      _socketName(socketName),
+      _connectionState(QLatin1String("starting")),
+      _logFlush(false)
+{
+}
+
+SyncDaemon::~SyncDaemon()
+{
+    qDebug() << "* Sync daemon shutdown";
+}
+
+QString SyncDaemon::defaultSocketName()
+{
+    QString user = QString::fromLocal8Bit( qgetenv("USER") );
+    if( user.isEmpty() ) {
+        user = QString::fromLocal8Bit( qgetenv("USERNAME") );
+    }
+    return Theme::instance()->appName().toLower() + QLatin1String("d-") + user;
+}
+
+bool SyncDaemon::listen()
+{
+    QLocalSocket probe;
+    probe.connectToServer( _socketName );
+    if( probe.waitForConnected( 500 ) ) {
+        qWarning() << "A sync daemon already listens on" << _socketName;
+        return false;
+    }
+
+    // the socket of a daemon that did not exit cleanly is still around.
+    QLocalServer::removeServer( _socketName );
+
+    _server = new QLocalServer( this );
+    if( !_server->listen( _socketName ) ) {
+        qWarning() << "Can not open the control socket" << _socketName << ":" << _server->errorString();
+        return false;
+    }
+    connect( _server, SIGNAL(newConnection()), SLOT(slotNewConnection()) );
+    qDebug() << "Control socket:" << _server->fullServerName();
+    return true;
+}
+
+void SyncDaemon::setLogFile( const QString& file, bool flush )
+{
+    _logFile.setFileName( file );
+    if( !_logFile.open( QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text ) ) {
+        qWarning() << "Can not open the log file" << file;
+        return;
+    }
+    _logStream.setDevice( &_logFile );
+    _logFlush = flush;
+    logging = true;
+    connect( Logger::instance(), SIGNAL(newLog(QString)), SLOT(slotNewLog(QString)) );
+}
+
+void SyncDaemon::setLogToStderr( bool on )
+{
+    if( !on || logging ) return;
+    _logFile.open( stderr, QIODevice::WriteOnly | QIODevice::Text );
+    _logStream.setDevice( &_logFile );
+    _logFlush = true;
+    logging = true;
+    connect( Logger::instance(), SIGNAL(newLog(QString)), SLOT(slotNewLog(QString)) );
+}
+
+void SyncDaemon::slotNewLog( const QString& msg )
+{
+    _logStream << msg << endl;
+    if( _logFlush ) {
+        _logStream.flush();
+    }
+}
+
+void SyncDaemon::start()
+{
+    qDebug() << QString::fromLatin1( "################## %1 daemon %2" ).arg( Theme::instance()->appName() )
+                .arg( Theme::instance()->version() );
+
+    _folderMan = new FolderMan(this);
+    connect( _folderMan, SIGNAL(folderSyncStateChange(QString)),
+             this, SLOT(slotSyncStateChange(QString)) );
+    _folderMan->setSyncEnabled(false);
+
+    setupProxy();
+
+    int cnt = _folderMan->setupFolders();
+    qDebug() << "Set up " << cnt << " folders.";
+
+    connect( ownCloudInfo::instance(), SIGNAL(sslFailed(QNetworkReply*, QList<QSslError>)),
+             this, SLOT(slotSSLFailed(QNetworkReply*, QList<QSslError>)) );
+
+    QTimer::singleShot( 0, this, SLOT( slotStartFolderSetup() ));
+}
+
+void SyncDaemon::setupProxy()
+{
+    MirallConfigFile cfg;
+    QNetworkProxy proxy;
+    proxy.setHostName( cfg.proxyHostName() );
+    proxy.setPort( cfg.proxyPort() );
+    if( cfg.proxyNeedsAuth() ) {
+        proxy.setUser( cfg.proxyUser() );
+        proxy.setPassword( cfg.proxyPassword() );
+    }
+
+    switch( cfg.proxyType() ) {
+    case QNetworkProxy::NoProxy:
+        QNetworkProxy::setApplicationProxy(QNetworkProxy::NoProxy);
+        break;
+    case QNetworkProxy::DefaultProxy:
+        QNetworkProxyFactory::setUseSystemConfiguration(true);
+        break;
+    case QNetworkProxy::Socks5Proxy:
+        proxy.setType(QNetworkProxy::Socks5Proxy);
+        QNetworkProxy::setApplicationProxy(proxy);
+        break;
+    case QNetworkProxy::HttpProxy:
+        proxy.setType(QNetworkProxy::HttpProxy);
+        QNetworkProxy::setApplicationProxy(proxy);
+        break;
+    default:
+        break;
+    }
+    _folderMan->setProxy();
+}
+
+void SyncDaemon::slotStartFolderSetup()
+{
+    if( !ownCloudInfo::instance()->isConfigured() ) {
+        qWarning() << "No server is configured, set up the connection with the client first.";
+        QCoreApplication::exit( EXIT_DAEMON_ERROR );
+        return;
+    }
+    _connectionState = QLatin1String("connecting");
+
+    connect( ownCloudInfo::instance(), SIGNAL(ownCloudInfoFound(QString,QString,QString,QString)),
+             SLOT(slotOwnCloudFound(QString,QString,QString,QString)) );
+    connect( ownCloudInfo::instance(), SIGNAL(noOwncloudFound(QNetworkReply*)),
+             SLOT(slotNoOwnCloudFound(QNetworkReply*)) );
+
+    ownCloudInfo::instance()->checkInstallation();
+}
+
+void SyncDaemon::slotOwnCloudFound( const QString& url, const QString& versionStr,
+                                    const QString& version, const QString& edition )
+{
+    Q_UNUSED(edition)
+    qDebug() << "** Daemon: ownCloud found: " << url << " with version " << versionStr << "(" << version << ")";
+
+    disconnect( ownCloudInfo::instance(), SIGNAL(ownCloudInfoFound(QString,QString,QString,QString)),
+                this, SLOT(slotOwnCloudFound(QString,QString,QString,QString)) );
+    disconnect( ownCloudInfo::instance(), SIGNAL(noOwncloudFound(QNetworkReply*)),
+                this, SLOT(slotNoOwnCloudFound(QNetworkReply*)) );
+
+    MirallConfigFile cfg;
+    cfg.setOwnCloudVersion( version );
+    if( version.startsWith( QLatin1String("4.0") ) ) {
+        qWarning() << "The configured server is too old for this client.";
+        _connectionState = QLatin1String("server too old");
+        return;
+    }
+
+    if( CredentialStore::instance()->state() == CredentialStore::Ok ) {
+        slotCredentialsFetched( true );
+        return;
+    }
+    if( !cfg.passwordStorageAllowed() ) {
+        // the credential store would open a password dialog.
+        qWarning() << "The password is not stored, the daemon can not ask for it.";
+        _connectionState = QLatin1String("no credentials");
+        return;
+    }
+    connect( CredentialStore::instance(), SIGNAL(fetchCredentialsFinished(bool)),
+             this, SLOT(slotCredentialsFetched(bool)) );
+    CredentialStore::instance()->fetchCredentials();
+}
+
+void SyncDaemon::slotNoOwnCloudFound( QNetworkReply *reply )
+{
+    Q_UNUSED(reply)
+    qDebug() << "** Daemon: NO ownCloud found! Trying again in" << SERVER_RETRY_SEC << "seconds.";
+
+    disconnect( ownCloudInfo::instance(), SIGNAL(ownCloudInfoFound(QString,QString,QString,QString)),
+                this, SLOT(slotOwnCloudFound(QString,QString,QString,QString)) );
+    disconnect( ownCloudInfo::instance(), SIGNAL(noOwncloudFound(QNetworkReply*)),
+                this, SLOT(slotNoOwnCloudFound(QNetworkReply*)) );
+
+    _connectionState = QLatin1String("offline");
+    QTimer::singleShot( SERVER_RETRY_SEC*1000, this, SLOT( slotStartFolderSetup() ));
+}
+
+void SyncDaemon::slotCredentialsFetched( bool ok )
+{
+    disconnect( CredentialStore::instance(), SIGNAL(fetchCredentialsFinished(bool)),
+                this, SLOT(slotCredentialsFetched(bool)) );
+
+    if( !ok ) {
+        qWarning() << "Could not fetch the credentials:" << CredentialStore::instance()->errorMessage();
+        _connectionState = QLatin1String("no credentials");
+        return;
+    }
+
+    ownCloudInfo::instance()->setCredentials( CredentialStore::instance()->user(),
+                                              CredentialStore::instance()->password() );
+
+    connect( ownCloudInfo::instance(), SIGNAL(ownCloudDirExists(QString,QNetworkReply*)),
+             this, SLOT(slotAuthCheck(QString,QNetworkReply*)) );
+    ownCloudInfo::instance()->getWebDAVPath( QLatin1String("/") ); // this call needs to be authenticated.
+}
+
+void SyncDaemon::slotAuthCheck( const QString&, QNetworkReply *reply )
+{
+    disconnect( ownCloudInfo::instance(), SIGNAL(ownCloudDirExists(QString,QNetworkReply*)),
+                this, SLOT(slotAuthCheck(QString,QNetworkReply*)) );
+
+    if( reply->error() == QNetworkReply::AuthenticationRequiredError ||
+            reply->error() == QNetworkReply::OperationCanceledError ) {
+        qWarning() << "The server does not accept the user name or the password.";
+        _connectionState = QLatin1String("credentials rejected");
+        return;
+    }
+
+    qDebug() << "######## Credentials are ok!";
+    _connectionState = QLatin1String("connected");
+    _folderMan->setSyncEnabled(true);
+    QMetaObject::invokeMethod(_folderMan, "slotScheduleFolderSync");
+    _folderMan->slotScheduleAllFolders();
+}
+
+void SyncDaemon::slotSSLFailed( QNetworkReply *reply, QList<QSslError> errors )
+{
+    Q_UNUSED(errors)
+    if( ownCloudInfo::instance()->certsUntrusted() ) {
+        return;
+    }
+    // certificates the user accepted in the client are known to
+    // ownCloudInfo already, nobody is here to accept new ones.
+    qWarning() << "The SSL certificate of" << reply->url().host()
+               << "is not trusted, accept it once in the client.";
+    ownCloudInfo::instance()->setCertsUntrusted(true);
+    _connectionState = QLatin1String("certificate not trusted");
+}
+
+void SyncDaemon::slotSyncStateChange( const QString& alias )
+{
+    Folder *f = _folderMan->folder( alias );
+    if( f ) {
+        qDebug() << "Folder" << alias << "is" << f->syncResult().statusString();
+    }
+}
+
+void SyncDaemon::slotNewConnection()
+{
+    while( _server->hasPendingConnections() ) {
+        QLocalSocket *socket = _server->nextPendingConnection();
+        connect( socket, SIGNAL(readyRead()), SLOT(slotReadCommand()) );
+        connect( socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()) );
+    }
+}
+
+void SyncDaemon::slotReadCommand()
+{
+    QLocalSocket *socket = qobject_cast<QLocalSocket*>( sender() );
+    if( !socket ) return;
+
+    while( socket->canReadLine() ) {
+        QString line = QString::fromUtf8( socket->readLine() ).trimmed();
+        if( line.isEmpty() ) continue;
+
+        qDebug() << "Control command:" << line;
+        bool ok = true;
+        QStringList reply = handleCommand( line, &ok );
+
+        QByteArray out;
+        if( ok ) {
+            foreach( const QString& l, reply ) {
+                out += l.toUtf8() + '\n';
+            }
+            out += "OK\n";
+        } else {
+            out += "ERROR " + reply.join( QLatin1String(" ") ).toUtf8() + '\n';
+        }
+        socket->write( out );
+    }
+}
+
+QStringList SyncDaemon::folderStatus() const
+{
+    QStringList lines;
+    lines << QString::fromLatin1("connection\t%1").arg( _connectionState );
+    lines << QString::fromLatin1("queue\t%1").arg( _folderMan->scheduleQueueDepth() );
+
+    foreach( Folder *f, _folderMan->map() ) {
+        SyncResult result = f->syncResult();
+        lines << QString::fromLatin1("folder\t%1\t%2\t%3\t%4")
+                 .arg( f->alias() )
+                 .arg( result.statusString() )
+                 .arg( f->syncEnabled() ? QLatin1String("enabled") : QLatin1String("paused") )
+                 .arg( f->path() );
+        QHash<QString, qint64> memory = result.memoryUsage();
+        if( !memory.isEmpty() ) {
+            lines << QString::fromLatin1("\tmemory %1: %2")
+                     .arg( Utility::octetsToString( MemoryUsage::total(memory) ) )
+                     .arg( MemoryUsage::toString(memory) );
+        }
+        if( result.pollInterval() > 0 ) {
+            lines << QString::fromLatin1("\tpoll %1 sec: %2")
+                     .arg( result.pollInterval() / 1000 )
+                     .arg( result.pollIntervalReason() );
+        }
+        if( result.status() == SyncResult::Planned ) {
+            foreach( const QString& l, result.plan().summary() ) {
+                lines << QLatin1String("\t") + l;
+            }
+        } else if( result.status() == SyncResult::Error ) {
+            foreach( const QString& l, result.errorStrings() ) {
+                lines << QLatin1String("\t") + l;
+            }
+        }
+    }
+    return lines;
+}
+
+QStringList SyncDaemon::setBandwidthLimit( const QStringList& args, bool *ok )
+{
+    const QString direction = args.value(0).toLower();
+    QString value = args.value(1);
+    bool percent = value.endsWith( QLatin1Char('%') );
+    if( percent ) value.chop(1);
+
+    bool valid = false;
+    int limit = value.toInt( &valid );
+    if( args.count() != 2 || !valid || limit < 0 || (percent && limit > 100)
+            || (direction != QLatin1String("up") && direction != QLatin1String("down")) ) {
+        *ok = false;
+        return QStringList( QLatin1String("usage: limit up|down <KB/s>|<percent>%") );
+    }
+
+    MirallConfigFile cfg;
+    if( direction == QLatin1String("up") ) {
+        cfg.setUploadLimit( percent ? 0 : limit, percent ? limit : 0 );
+    } else {
+        cfg.setDownloadLimit( percent ? 0 : limit, percent ? limit : 0 );
+    }
+    // a running sync keeps its limit, the next run reads the new one.
+
+    QString text;
+    if( limit == 0 ) {
+        text = QLatin1String("no limit");
+    } else if( percent ) {
+        text = QString::fromLatin1("%1% of the measured capacity").arg( limit );
+    } else {
+        text = QString::fromLatin1("%1 KB/s").arg( limit );
+    }
+    return QStringList( QString::fromLatin1("%1load limit: %2").arg( direction ).arg( text ) );
+}
+
+QStringList SyncDaemon::handleCommand( const QString& line, bool *ok )
+{
+    QStringList args = line.split( QLatin1Char(' '), QString::SkipEmptyParts );
+    const QString command = args.takeFirst().toLower();
+
+    // the arguments of limit are not a folder alias
+    if( command == QLatin1String("limit") ) {
+        return setBandwidthLimit( args, ok );
+    }
+    const QString alias = args.join( QLatin1String(" ") );
+
+    Folder *f = 0;
+    if( !alias.isEmpty() ) {
+        f = _folderMan->folder( alias );
+        if( !f ) {
+            *ok = false;
+            return QStringList( QString::fromLatin1("unknown folder '%1'").arg(alias) );
+        }
+    }
+
+    if( command == QLatin1String("status") ) {
+        return folderStatus();
+    } else if( command == QLatin1String("sync") ) {
+        if( f ) {
+            f->slotChanged();
+        } else {
+            foreach( Folder *folder, _folderMan->map() ) {
+                folder->slotChanged();
+            }
+        }
+    } else if( command == QLatin1String("pause") ) {
+        if( f ) {
+            _folderMan->slotEnableFolder( alias, false );
+        } else {
+            // the running sync finishes, no new one is started.
+            _folderMan->setSyncEnabled(false);
+        }
+    } else if( command == QLatin1String("resume") ) {
+        if( f ) {
+            _folderMan->slotEnableFolder( alias, true );
+            f->slotChanged();
+        } else if( _connectionState == QLatin1String("connected") ) {
+            _folderMan->setSyncEnabled(true);
+            QMetaObject::invokeMethod(_folderMan, "slotScheduleFolderSync");
+        } else {
+            *ok = false;
+            return QStringList( QString::fromLatin1("not connected: %1").arg(_connectionState) );
+        }
+    } else if( command == QLatin1String("plan") ) {
+        if( !f ) {
+            *ok = false;
+            return QStringList( QLatin1String("plan needs a folder alias") );
+        }
+        f->slotRequestPlan();
+    } else if( command == QLatin1String("reconnect") ) {
+        if( _connectionState == QLatin1String("connecting") ) {
+            return QStringList( QLatin1String("already connecting") );
+        }
+        _folderMan->setSyncEnabled(false);
+        CredentialStore::instance()->reset();
+        ownCloudInfo::instance()->setCertsUntrusted(false);
+        QTimer::singleShot( 0, this, SLOT( slotStartFolderSetup() ));
+    } else if( command == QLatin1String("quit") ) {
+        _folderMan->setSyncEnabled(false);
+        _folderMan->terminateSyncProcess();
+        QTimer::singleShot( 0, QCoreApplication::instance(), SLOT(quit()) );
+    } else if( command == QLatin1String("help") ) {
+        return QString::fromLatin1( commandsC ).split( QLatin1Char('\n'), QString::SkipEmptyParts );
+    } else {
+        *ok = false;
+        return QStringList( QString::fromLatin1("unknown command '%1'").arg(command) );
+    }
+    return QStringList();
+}
+
+}
+
+using namespace Mirall;
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    // the same name as the client, the config location depends on it.
+    app.setApplicationName( Theme::instance()->appNameGUI() );
+    qInstallMsgHandler( messageHandler );
+
+    QStringList args = app.arguments();
+    QString confDir, socketName, logFile, controlCommand;
+    bool logFlush = false;
+    bool verbose = false;
+
+    for( int i = 1; i < args.count(); i++ ) {
+        const QString option = args.at(i);
+        bool hasValue = i+1 < args.count();
+
+        if( option == QLatin1String("-h") || option == QLatin1String("--help") ) {
+            std::cout << usageC;
+            return EXIT_DAEMON_OK;
+        } else if( option == QLatin1String("--confdir") && hasValue ) {
+            confDir = args.at(++i);
+        } else if( option == QLatin1String("--socket") && hasValue ) {
+            socketName = args.at(++i);
+        } else if( option == QLatin1String("--logfile") && hasValue ) {
+            logFile = args.at(++i);
+        } else if( option == QLatin1String("--logflush") ) {
+            logFlush = true;
+        } else if( option == QLatin1String("--verbose") ) {
+            verbose = true;
+        } else if( option == QLatin1String("--control") && hasValue ) {
+            // the rest of the line is the command, aliases may contain blanks.
+            controlCommand = QStringList( args.mid(i+1) ).join( QLatin1String(" ") );
+            break;
+        } else {
+            std::cerr << usageC;
+            return EXIT_USAGE;
+        }
+    }
+
+    if( socketName.isEmpty() ) {
+        socketName = SyncDaemon::defaultSocketName();
+    }
+    if( !controlCommand.isEmpty() ) {
+        return sendControlCommand( socketName, controlCommand );
+    }
+
+    if( !confDir.isEmpty() ) {
+        MirallConfigFile::setConfDir( confDir );
+    }
+
+    // the client takes the same lock, only one of them may sync the
+    // folders of a configuration.
+    MirallConfigFile cfg;
+    QDir().mkpath( cfg.configPath() );
+    SharedTools::QtLockedFile instanceLock( cfg.instanceLockFile() );
+    if( instanceLock.open( QIODevice::ReadWrite ) ) {
+        if( !instanceLock.lock( SharedTools::QtLockedFile::WriteLock, false ) ) {
+            std::cerr << "The configuration is in use by "
+                      << qPrintable( QString::fromUtf8( instanceLock.readAll() ).trimmed() ) << std::endl;
+            return EXIT_DAEMON_ERROR;
+        }
+        instanceLock.resize(0);
+        instanceLock.write( QString::fromLatin1("owncloudd %1\n").arg( app.applicationPid() ).toUtf8() );
+        instanceLock.flush();
+    } else {
+        qWarning() << "Can not open the instance lock" << instanceLock.fileName();
+    }
+
+    SyncDaemon daemon( socketName );
+    if( !logFile.isEmpty() ) {
+        daemon.setLogFile( logFile, logFlush );
+    }
+    daemon.setLogToStderr( verbose );
+
+    if( !daemon.listen() ) {
+        return EXIT_DAEMON_ERROR;
+    }
+    daemon.start();
+
+    return app.exec();
+}
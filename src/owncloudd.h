@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) by agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ */
+
+#ifndef OWNCLOUDD_H
+#define OWNCLOUDD_H
+
+#include <QObject>
+#include <QStringList>
+#include <QList>
+#include <QSslError>
+#include <QFile>
+#include <QTextStream>
+
+class QLocalServer;
+class QNetworkReply;
+
+namespace Mirall {
+
+class FolderMan;
+
+/**
+ * The sync daemon: runs the configured folders with their watchers and
+ * poll timers like the tray client does, but without any widgets.
+ *
+ * It is controlled through a local socket. Every command is one line,
+ * the answer are zero or more lines followed by a line starting with
+ * either "OK" or "ERROR".
+ */
+class SyncDaemon : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SyncDaemon( const QString& socketName, QObject *parent = 0 );
+    ~SyncDaemon();
+
+    /**
+     * opens the control socket, false if another daemon already
+     * listens on it or the socket can not be created.
+     */
+    bool listen();
+
+    void setLogFile( const QString&, bool flush );
+    void setLogToStderr( bool );
+
+    static QString defaultSocketName();
+
+public slots:
+    void start();
+
+private slots:
+    void slotStartFolderSetup();
+    void slotOwnCloudFound( const QString&, const QString&, const QString&, const QString& );
+    void slotNoOwnCloudFound( QNetworkReply* );
+    void slotCredentialsFetched( bool );
+    void slotAuthCheck( const QString&, QNetworkReply* );
+    void slotSSLFailed( QNetworkReply*, QList<QSslError> );
+    void slotSyncStateChange( const QString& );
+
+    void slotNewConnection();
+    void slotReadCommand();
+
+    void slotNewLog( const QString& );
+
+private:
+    void setupProxy();
+    QStringList handleCommand( const QString&, bool *ok );
+    QStringList folderStatus() const;
+    QStringList setBandwidthLimit( const QStringList& args, bool *ok );
+
+    FolderMan    *_folderMan;
+    QLocalServer *_server;
+    QString       _socketName;
+    QString       _connectionState;
+    QFile         _logFile;
+    QTextStream   _logStream;
+    bool          _logFlush;
+};
+
+}
+
+#endif // OWNCLOUDD_H
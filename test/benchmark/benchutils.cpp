@@ -0,0 +1,97 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#include "benchutils.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QtAlgorithms>
+
+QString BenchUtils::jsonString( const QString& str )
+{
+    QString re;
+    re.reserve( str.length() + 2 );
+    re.append( QLatin1Char('"') );
+    foreach( const QChar& c, str ) {
+        switch( c.unicode() ) {
+        case '"':  re.append( QLatin1String("\\\"") ); break;
+        case '\\': re.append( QLatin1String("\\\\") ); break;
+        case '\n': re.append( QLatin1String("\\n") ); break;
+        case '\r': re.append( QLatin1String("\\r") ); break;
+        case '\t': re.append( QLatin1String("\\t") ); break;
+        default:
+            if( c.unicode() < 0x20 ) {
+                re.append( QString::fromLatin1("\\u%1").arg( c.unicode(), 4, 16, QLatin1Char('0') ) );
+            } else {
+                re.append( c );
+            }
+        }
+    }
+    re.append( QLatin1Char('"') );
+    return re;
+}
+
+bool BenchUtils::removeTree( const QString& path )
+{
+    QFileInfo fi( path );
+    if( !fi.isDir() || fi.isSymLink() ) {
+        return QFile::remove( path );
+    }
+    QDir dir( path );
+    foreach( const QFileInfo& entry, dir.entryInfoList( QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot ) ) {
+        if( !removeTree( entry.absoluteFilePath() ) ) return false;
+    }
+    return QDir().rmdir( path );
+}
+
+qint64 BenchUtils::percentile( QVector<qint64>& samples, double percent )
+{
+    if( samples.isEmpty() ) return -1;
+    qSort( samples );
+    int index = int( percent / 100.0 * (samples.count()-1) + 0.5 );
+    return samples.at( qBound( 0, index, samples.count()-1 ) );
+}
+
+namespace Mirall {
+
+BenchSyncObserver::BenchSyncObserver( QObject *parent )
+    : QObject( parent ),
+      _result( SyncResult::NotYetStarted )
+{
+}
+
+SyncResult BenchSyncObserver::result() const
+{
+    return _result;
+}
+
+void BenchSyncObserver::slotCSyncError( const QString& err )
+{
+    _result.setErrorString( err );
+}
+
+void BenchSyncObserver::slotPhaseTime( const QString& phase, int msec )
+{
+    _result.setPhaseTime( phase, msec );
+}
+
+void BenchSyncObserver::slotTransferProgress( int files, qint64 uploaded, qint64 downloaded )
+{
+    _result.setTransferred( files, uploaded, downloaded );
+}
+
+void BenchSyncObserver::slotTreeWalkResult( const SyncFileItemVector& items )
+{
+    _result.setSyncFileItemVector( items );
+}
+
+void BenchSyncObserver::slotAboutToRemoveAllFiles( SyncFileItem::Direction, bool *cancel )
+{
+    *cancel = false;
+}
+
+}
@@ -0,0 +1,63 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#ifndef MIRALL_BENCHUTILS_H
+#define MIRALL_BENCHUTILS_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include "mirall/syncresult.h"
+#include "mirall/syncfileitem.h"
+
+/**
+ * Helpers the benchmark programs share.
+ */
+class BenchUtils
+{
+public:
+    // str as a quoted JSON string
+    static QString jsonString( const QString& str );
+
+    // removes path and everything below it
+    static bool removeTree( const QString& path );
+
+    /**
+     * the value below which the given percentage of the samples lies,
+     * the samples are sorted in place. -1 if there are none.
+     */
+    static qint64 percentile( QVector<qint64>& samples, double percent );
+};
+
+namespace Mirall {
+
+/**
+ * Collects the signals of one CSyncThread run of the benchmark into
+ * a SyncResult. Removing all files is always allowed.
+ */
+class BenchSyncObserver : public QObject
+{
+    Q_OBJECT
+public:
+    explicit BenchSyncObserver( QObject *parent = 0 );
+
+    SyncResult result() const;
+
+public slots:
+    void slotCSyncError( const QString& );
+    void slotPhaseTime( const QString&, int );
+    void slotTransferProgress( int, qint64, qint64 );
+    void slotTreeWalkResult( const SyncFileItemVector& );
+    void slotAboutToRemoveAllFiles( SyncFileItem::Direction, bool* );
+
+private:
+    SyncResult _result;
+};
+
+}
+
+#endif
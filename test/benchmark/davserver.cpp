@@ -0,0 +1,590 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#include "davserver.h"
+
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <QUrl>
+#include <QRegExp>
+#include <QDateTime>
+#include <QLocale>
+#include <QCryptographicHash>
+#include <QStringList>
+#include <QDebug>
+
+#define DAV_PREFIX "/remote.php/webdav"
+
+namespace {
+
+QByteArray httpDate( qint64 secs )
+{
+    QDateTime dt = QDateTime::fromTime_t( uint(secs) ).toUTC();
+    return QLocale::c().toString( dt, QLatin1String("ddd, dd MMM yyyy hh:mm:ss 'GMT'") ).toLatin1();
+}
+
+QByteArray statusText( int code )
+{
+    switch( code ) {
+    case 100: return "Continue";
+    case 200: return "OK";
+    case 201: return "Created";
+    case 204: return "No Content";
+    case 207: return "Multi-Status";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 409: return "Conflict";
+    case 412: return "Precondition Failed";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    default:  return "Unknown";
+    }
+}
+
+bool removeTree( const QString& path )
+{
+    QFileInfo fi( path );
+    if( !fi.isDir() || fi.isSymLink() ) {
+        return QFile::remove( path );
+    }
+    QDir dir( path );
+    foreach( const QFileInfo& entry, dir.entryInfoList( QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot ) ) {
+        if( !removeTree( entry.absoluteFilePath() ) ) return false;
+    }
+    return QDir().rmdir( path );
+}
+
+}
+
+DavServer::DavServer( const QString& rootDir, QObject *parent )
+    : QTcpServer(parent),
+      _root( QDir(rootDir).absolutePath() )
+{
+    connect( this, SIGNAL(newConnection()), SLOT(slotNewConnection()) );
+}
+
+QString DavServer::davPrefix()
+{
+    return QLatin1String(DAV_PREFIX);
+}
+
+DavServer::Stats DavServer::stats() const
+{
+    QMutexLocker locker( &_statsMutex );
+    return _stats;
+}
+
+void DavServer::resetStats()
+{
+    QMutexLocker locker( &_statsMutex );
+    _stats = Stats();
+}
+
+void DavServer::slotNewConnection()
+{
+    while( hasPendingConnections() ) {
+        QTcpSocket *socket = nextPendingConnection();
+        connect( socket, SIGNAL(readyRead()), SLOT(slotReadyRead()) );
+        connect( socket, SIGNAL(disconnected()), SLOT(slotDisconnected()) );
+    }
+}
+
+void DavServer::slotDisconnected()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>( sender() );
+    if( !socket ) return;
+    _buffers.remove( socket );
+    _requests.remove( socket );
+    socket->deleteLater();
+}
+
+void DavServer::slotReadyRead()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>( sender() );
+    if( !socket ) return;
+
+    QByteArray data = socket->readAll();
+    {
+        QMutexLocker locker( &_statsMutex );
+        _stats.bytesReceived += data.size();
+    }
+    QByteArray& buf = _buffers[socket];
+    buf.append( data );
+
+    forever {
+        Request& req = _requests[socket];
+        if( !req.headerDone ) {
+            int end = buf.indexOf( "\r\n\r\n" );
+            if( end == -1 ) return;
+            if( !parseHeader( &req, buf.left(end) ) ) {
+                reply( socket, 501 );
+                socket->disconnectFromHost();
+                return;
+            }
+            buf.remove( 0, end+4 );
+            if( req.headers.value("expect").toLower() == "100-continue" ) {
+                socket->write( "HTTP/1.1 100 Continue\r\n\r\n" );
+            }
+        }
+
+        qint64 missing = req.contentLength - req.body.size();
+        if( missing > 0 ) {
+            if( buf.isEmpty() ) return;
+            int take = int( qMin( missing, qint64(buf.size()) ) );
+            req.body.append( buf.left(take) );
+            buf.remove( 0, take );
+            if( req.body.size() < req.contentLength ) return;
+        }
+
+        Request complete = req;
+        _requests.remove( socket );
+        handle( socket, complete );
+        if( socket->state() != QAbstractSocket::ConnectedState ) return;
+    }
+}
+
+bool DavServer::parseHeader( Request *req, const QByteArray& header )
+{
+    QList<QByteArray> lines = header.split( '\n' );
+    QList<QByteArray> requestLine = lines.takeFirst().trimmed().split( ' ' );
+    if( requestLine.count() < 2 ) return false;
+
+    req->method = requestLine.at(0).toUpper();
+    QByteArray rawPath = requestLine.at(1);
+    int query = rawPath.indexOf( '?' );
+    if( query > -1 ) rawPath.truncate( query );
+    req->path = QUrl::fromPercentEncoding( rawPath );
+
+    foreach( const QByteArray& line, lines ) {
+        int colon = line.indexOf( ':' );
+        if( colon < 1 ) continue;
+        req->headers.insert( line.left(colon).trimmed().toLower(), line.mid(colon+1).trimmed() );
+    }
+    if( req->headers.contains("transfer-encoding") ) {
+        // neon sends all bodies with a content length.
+        return false;
+    }
+    req->contentLength = req->headers.value("content-length", "0").toLongLong();
+    req->headerDone = true;
+    return true;
+}
+
+void DavServer::reply( QTcpSocket *socket, int code, const QByteArray& body,
+                       const QHash<QByteArray, QByteArray>& headers )
+{
+    QByteArray out = "HTTP/1.1 " + QByteArray::number(code) + ' ' + statusText(code) + "\r\n";
+    QHash<QByteArray, QByteArray>::const_iterator it = headers.constBegin();
+    for( ; it != headers.constEnd(); ++it ) {
+        out += it.key() + ": " + it.value() + "\r\n";
+    }
+    if( !headers.contains("Content-Length") ) {
+        out += "Content-Length: " + QByteArray::number(body.size()) + "\r\n";
+    }
+    out += "\r\n";
+    out += body;
+    socket->write( out );
+
+    QMutexLocker locker( &_statsMutex );
+    _stats.bytesSent += out.size();
+}
+
+void DavServer::handle( QTcpSocket *socket, const Request& req )
+{
+    {
+        QMutexLocker locker( &_statsMutex );
+        _stats.requests++;
+        _stats.methods[QString::fromLatin1(req.method)]++;
+    }
+
+    if( !req.path.startsWith( davPrefix() ) ) {
+        reply( socket, 404 );
+        return;
+    }
+
+    if( req.method == "OPTIONS" ) {
+        QHash<QByteArray, QByteArray> headers;
+        headers.insert( "DAV", "1,2" );
+        headers.insert( "Allow", "OPTIONS, GET, HEAD, PUT, DELETE, MKCOL, MOVE, PROPFIND, PROPPATCH" );
+        reply( socket, 200, QByteArray(), headers );
+    } else if( req.method == "PROPFIND" ) {
+        propfind( socket, req );
+    } else if( req.method == "PROPPATCH" ) {
+        proppatch( socket, req );
+    } else if( req.method == "GET" ) {
+        get( socket, req, false );
+    } else if( req.method == "HEAD" ) {
+        get( socket, req, true );
+    } else if( req.method == "PUT" ) {
+        put( socket, req );
+    } else if( req.method == "MKCOL" ) {
+        mkcol( socket, req );
+    } else if( req.method == "DELETE" ) {
+        remove( socket, req );
+    } else if( req.method == "MOVE" ) {
+        move( socket, req );
+    } else {
+        qDebug() << "DavServer: unsupported method" << req.method;
+        reply( socket, 501 );
+    }
+
+    if( req.headers.value("connection").toLower() == "close" ) {
+        socket->disconnectFromHost();
+    }
+}
+
+static QString relativePath( const QString& urlPath )
+{
+    QString rel = urlPath.mid( QString::fromLatin1(DAV_PREFIX).length() );
+    while( rel.startsWith( QLatin1Char('/') ) ) rel.remove( 0, 1 );
+    while( rel.endsWith( QLatin1Char('/') ) ) rel.chop( 1 );
+    return rel;
+}
+
+QString DavServer::localPath( const QString& relPath ) const
+{
+    if( relPath.isEmpty() ) return _root;
+    return _root + QLatin1Char('/') + relPath;
+}
+
+bool DavServer::parentExists( const QString& relPath ) const
+{
+    int slash = relPath.lastIndexOf( QLatin1Char('/') );
+    if( slash == -1 ) return true;
+    return QFileInfo( localPath( relPath.left(slash) ) ).isDir();
+}
+
+qint64 DavServer::mtime( const QString& relPath ) const
+{
+    if( _mtimes.contains( relPath ) ) {
+        return _mtimes.value( relPath );
+    }
+    return QFileInfo( localPath(relPath) ).lastModified().toTime_t();
+}
+
+void DavServer::forgetMtimes( const QString& relPath )
+{
+    const QString prefix = relPath + QLatin1Char('/');
+    QHash<QString, qint64>::iterator it = _mtimes.begin();
+    while( it != _mtimes.end() ) {
+        if( it.key() == relPath || it.key().startsWith( prefix ) ) {
+            it = _mtimes.erase( it );
+        } else {
+            ++it;
+        }
+    }
+}
+
+void DavServer::renameMtimes( const QString& from, const QString& to )
+{
+    const QString prefix = from + QLatin1Char('/');
+    QHash<QString, qint64> moved;
+    QHash<QString, qint64>::iterator it = _mtimes.begin();
+    while( it != _mtimes.end() ) {
+        if( it.key() == from ) {
+            moved.insert( to, it.value() );
+            it = _mtimes.erase( it );
+        } else if( it.key().startsWith( prefix ) ) {
+            moved.insert( to + it.key().mid( from.length() ), it.value() );
+            it = _mtimes.erase( it );
+        } else {
+            ++it;
+        }
+    }
+    forgetMtimes( to );
+    _mtimes.unite( moved );
+}
+
+QByteArray DavServer::propEntry( const QString& relPath ) const
+{
+    QFileInfo fi( localPath(relPath) );
+    qint64 mt = mtime( relPath );
+
+    QByteArray href = DAV_PREFIX "/" + QUrl::toPercentEncoding( relPath, "/" );
+    if( fi.isDir() && !relPath.isEmpty() ) href += '/';
+
+    QByteArray etag = QCryptographicHash::hash( relPath.toUtf8() + QByteArray::number(mt)
+                                                + QByteArray::number(fi.size()),
+                                                QCryptographicHash::Md5 ).toHex();
+
+    QByteArray xml = "<d:response><d:href>" + href + "</d:href><d:propstat><d:prop>";
+    xml += "<d:getlastmodified>" + httpDate(mt) + "</d:getlastmodified>";
+    if( fi.isDir() ) {
+        xml += "<d:resourcetype><d:collection/></d:resourcetype>";
+    } else {
+        xml += "<d:resourcetype/>";
+        xml += "<d:getcontentlength>" + QByteArray::number(fi.size()) + "</d:getcontentlength>";
+    }
+    xml += "<d:getetag>\"" + etag + "\"</d:getetag>";
+    xml += "</d:prop><d:status>HTTP/1.1 200 OK</d:status></d:propstat></d:response>\n";
+    return xml;
+}
+
+void DavServer::propfind( QTcpSocket *socket, const Request& req )
+{
+    const QString rel = relativePath( req.path );
+    QFileInfo fi( localPath(rel) );
+    if( !fi.exists() ) {
+        reply( socket, 404 );
+        return;
+    }
+
+    QByteArray xml = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<d:multistatus xmlns:d=\"DAV:\">\n";
+    xml += propEntry( rel );
+    if( fi.isDir() && req.headers.value("depth") != "0" ) {
+        QDir dir( fi.absoluteFilePath() );
+        foreach( const QString& name, dir.entryList( QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot ) ) {
+            xml += propEntry( rel.isEmpty() ? name : rel + QLatin1Char('/') + name );
+        }
+    }
+    xml += "</d:multistatus>\n";
+
+    QHash<QByteArray, QByteArray> headers;
+    headers.insert( "Content-Type", "application/xml; charset=utf-8" );
+    reply( socket, 207, xml, headers );
+}
+
+void DavServer::proppatch( QTcpSocket *socket, const Request& req )
+{
+    const QString rel = relativePath( req.path );
+    if( !QFileInfo( localPath(rel) ).exists() ) {
+        reply( socket, 404 );
+        return;
+    }
+
+    QRegExp rx( QLatin1String("<[^>]*lastmodified[^>]*>\\s*(\\d+)\\s*<") );
+    if( rx.indexIn( QString::fromUtf8(req.body) ) > -1 ) {
+        _mtimes.insert( rel, rx.cap(1).toLongLong() );
+    }
+
+    QByteArray xml = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<d:multistatus xmlns:d=\"DAV:\">"
+                     "<d:response><d:href>" DAV_PREFIX "/" + QUrl::toPercentEncoding( rel, "/" ) + "</d:href>"
+                     "<d:propstat><d:prop><d:lastmodified/></d:prop>"
+                     "<d:status>HTTP/1.1 200 OK</d:status></d:propstat></d:response></d:multistatus>\n";
+    QHash<QByteArray, QByteArray> headers;
+    headers.insert( "Content-Type", "application/xml; charset=utf-8" );
+    reply( socket, 207, xml, headers );
+}
+
+void DavServer::get( QTcpSocket *socket, const Request& req, bool headOnly )
+{
+    const QString rel = relativePath( req.path );
+    QFileInfo fi( localPath(rel) );
+    if( !fi.exists() ) {
+        reply( socket, 404 );
+        return;
+    }
+    if( fi.isDir() ) {
+        reply( socket, 405 );
+        return;
+    }
+
+    QFile file( fi.absoluteFilePath() );
+    if( !file.open( QIODevice::ReadOnly ) ) {
+        reply( socket, 500 );
+        return;
+    }
+
+    QHash<QByteArray, QByteArray> headers;
+    headers.insert( "Content-Type", "application/octet-stream" );
+    headers.insert( "Last-Modified", httpDate( mtime(rel) ) );
+    if( headOnly ) {
+        headers.insert( "Content-Length", QByteArray::number( fi.size() ) );
+        reply( socket, 200, QByteArray(), headers );
+    } else {
+        reply( socket, 200, file.readAll(), headers );
+    }
+}
+
+void DavServer::put( QTcpSocket *socket, const Request& req )
+{
+    QString rel = relativePath( req.path );
+
+    QRegExp chunkRx( QLatin1String("^(.*)-chunking-(\\d+)-(\\d+)-(\\d+)$") );
+    if( req.headers.contains("oc-chunked") && chunkRx.exactMatch( rel ) ) {
+        // chunk files are collected next to the served tree.
+        const QString target = chunkRx.cap(1);
+        const QString id     = chunkRx.cap(2);
+        const int count      = chunkRx.cap(3).toInt();
+        const QString chunkDir = _root + QLatin1String(".chunks");
+        QDir().mkpath( chunkDir );
+
+        QFile chunk( chunkDir + QLatin1Char('/') + id + QLatin1Char('-') + chunkRx.cap(4) );
+        if( !chunk.open( QIODevice::WriteOnly ) ) {
+            reply( socket, 500 );
+            return;
+        }
+        chunk.write( req.body );
+        chunk.close();
+        {
+            QMutexLocker locker( &_statsMutex );
+            _stats.chunks++;
+        }
+
+        if( ++_chunks[id] < count ) {
+            reply( socket, 201 );
+            return;
+        }
+        _chunks.remove( id );
+        {
+            QMutexLocker locker( &_statsMutex );
+            _stats.chunkedFiles++;
+        }
+
+        QByteArray assembled;
+        for( int i = 0; i < count; i++ ) {
+            QFile part( chunkDir + QLatin1Char('/') + id + QLatin1Char('-') + QString::number(i) );
+            if( part.open( QIODevice::ReadOnly ) ) {
+                assembled.append( part.readAll() );
+                part.close();
+            }
+            part.remove();
+        }
+        Request whole = req;
+        whole.body = assembled;
+        whole.path = QLatin1String(DAV_PREFIX "/") + target;
+        whole.headers.remove( "oc-chunked" );
+        put( socket, whole );
+        return;
+    }
+
+    if( rel.isEmpty() || !parentExists( rel ) ) {
+        reply( socket, 409 );
+        return;
+    }
+
+    bool existed = QFileInfo( localPath(rel) ).exists();
+    QFile file( localPath(rel) );
+    if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+        reply( socket, 500 );
+        return;
+    }
+    file.write( req.body );
+    file.close();
+
+    if( req.headers.contains("x-oc-mtime") ) {
+        _mtimes.insert( rel, req.headers.value("x-oc-mtime").toLongLong() );
+    } else {
+        _mtimes.remove( rel );
+    }
+    reply( socket, existed ? 204 : 201 );
+}
+
+void DavServer::mkcol( QTcpSocket *socket, const Request& req )
+{
+    const QString rel = relativePath( req.path );
+    if( QFileInfo( localPath(rel) ).exists() ) {
+        reply( socket, 405 );
+        return;
+    }
+    if( !parentExists( rel ) ) {
+        reply( socket, 409 );
+        return;
+    }
+    reply( socket, QDir().mkdir( localPath(rel) ) ? 201 : 500 );
+}
+
+void DavServer::remove( QTcpSocket *socket, const Request& req )
+{
+    const QString rel = relativePath( req.path );
+    if( rel.isEmpty() || !QFileInfo( localPath(rel) ).exists() ) {
+        reply( socket, 404 );
+        return;
+    }
+    forgetMtimes( rel );
+    reply( socket, removeTree( localPath(rel) ) ? 204 : 500 );
+}
+
+void DavServer::move( QTcpSocket *socket, const Request& req )
+{
+    const QString from = relativePath( req.path );
+    QUrl dest = QUrl::fromEncoded( req.headers.value("destination") );
+    const QString to = relativePath( dest.path() );
+
+    if( from.isEmpty() || !QFileInfo( localPath(from) ).exists() ) {
+        reply( socket, 404 );
+        return;
+    }
+    if( to.isEmpty() || !parentExists( to ) ) {
+        reply( socket, 409 );
+        return;
+    }
+
+    bool existed = QFileInfo( localPath(to) ).exists();
+    if( existed ) {
+        if( req.headers.value("overwrite").toUpper() == "F" ) {
+            reply( socket, 412 );
+            return;
+        }
+        removeTree( localPath(to) );
+    }
+    if( !QDir().rename( localPath(from), localPath(to) ) ) {
+        reply( socket, 500 );
+        return;
+    }
+    renameMtimes( from, to );
+    reply( socket, existed ? 204 : 201 );
+}
+
+// ----------------------------------------------------------------------------------
+
+DavServerThread::DavServerThread( const QString& rootDir, QObject *parent )
+    : QThread(parent),
+      _rootDir(rootDir),
+      _server(0),
+      _port(0)
+{
+}
+
+quint16 DavServerThread::startServer()
+{
+    QMutexLocker locker( &_mutex );
+    start();
+    _ready.wait( &_mutex );
+    return _port;
+}
+
+void DavServerThread::stopServer()
+{
+    quit();
+    wait();
+}
+
+DavServer::Stats DavServerThread::stats() const
+{
+    QMutexLocker locker( &_mutex );
+    return _server ? _server->stats() : DavServer::Stats();
+}
+
+void DavServerThread::resetStats()
+{
+    QMutexLocker locker( &_mutex );
+    if( _server ) _server->resetStats();
+}
+
+void DavServerThread::run()
+{
+    DavServer server( _rootDir );
+    bool ok = server.listen( QHostAddress::LocalHost, 0 );
+    if( !ok ) {
+        qWarning() << "DavServer can not listen:" << server.errorString();
+    }
+
+    _mutex.lock();
+    _server = ok ? &server : 0;
+    _port   = ok ? server.serverPort() : 0;
+    _ready.wakeAll();
+    _mutex.unlock();
+
+    if( ok ) {
+        exec();
+    }
+
+    QMutexLocker locker( &_mutex );
+    _server = 0;
+}
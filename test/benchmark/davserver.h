@@ -0,0 +1,130 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#ifndef MIRALL_DAVSERVER_H
+#define MIRALL_DAVSERVER_H
+
+#include <QTcpServer>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+#include <QMap>
+#include <QByteArray>
+#include <QString>
+
+class QTcpSocket;
+
+/**
+ * A small WebDAV stand-in for the ownCloud server, good enough for the
+ * requests the csync owncloud module sends: OPTIONS, PROPFIND, PROPPATCH,
+ * GET, HEAD, PUT (also chunked uploads), MKCOL, DELETE and MOVE.
+ *
+ * The files live in a directory on disk, the mtimes set by PROPPATCH or
+ * the X-OC-Mtime header are kept in memory. There is no authentication.
+ */
+class DavServer : public QTcpServer
+{
+    Q_OBJECT
+public:
+    struct Stats {
+        Stats() : requests(0), bytesReceived(0), bytesSent(0), chunks(0), chunkedFiles(0) {}
+        int                 requests;
+        QMap<QString, int>  methods;
+        qint64              bytesReceived;
+        qint64              bytesSent;
+        // chunk PUTs received and files assembled from them
+        int                 chunks;
+        int                 chunkedFiles;
+    };
+
+    DavServer( const QString& rootDir, QObject *parent = 0 );
+
+    // the url path the WebDAV tree is served under
+    static QString davPrefix();
+
+    Stats stats() const;
+    void resetStats();
+
+private slots:
+    void slotNewConnection();
+    void slotReadyRead();
+    void slotDisconnected();
+
+private:
+    struct Request {
+        Request() : headerDone(false), contentLength(0) {}
+        bool                    headerDone;
+        QByteArray              method;
+        QString                 path;
+        QHash<QByteArray, QByteArray> headers;
+        qint64                  contentLength;
+        QByteArray              body;
+    };
+
+    bool parseHeader( Request *req, const QByteArray& header );
+    void handle( QTcpSocket*, const Request& );
+    void reply( QTcpSocket*, int code, const QByteArray& body = QByteArray(),
+                const QHash<QByteArray, QByteArray>& headers = (QHash<QByteArray, QByteArray>()) );
+
+    void propfind( QTcpSocket*, const Request& );
+    void proppatch( QTcpSocket*, const Request& );
+    void get( QTcpSocket*, const Request&, bool headOnly );
+    void put( QTcpSocket*, const Request& );
+    void mkcol( QTcpSocket*, const Request& );
+    void remove( QTcpSocket*, const Request& );
+    void move( QTcpSocket*, const Request& );
+
+    QByteArray propEntry( const QString& relPath ) const;
+    QString localPath( const QString& relPath ) const;
+    bool parentExists( const QString& relPath ) const;
+    qint64 mtime( const QString& relPath ) const;
+    void forgetMtimes( const QString& relPath );
+    void renameMtimes( const QString& from, const QString& to );
+
+    QString                       _root;
+    QHash<QTcpSocket*, QByteArray> _buffers;
+    QHash<QTcpSocket*, Request>   _requests;
+    QHash<QString, qint64>        _mtimes;
+    // chunk files received so far, per transfer id
+    QHash<QString, int>           _chunks;
+
+    mutable QMutex _statsMutex;
+    Stats          _stats;
+};
+
+/**
+ * Runs a DavServer with its own event loop, so that a sync can block the
+ * calling thread while the server answers its requests.
+ */
+class DavServerThread : public QThread
+{
+    Q_OBJECT
+public:
+    explicit DavServerThread( const QString& rootDir, QObject *parent = 0 );
+
+    /**
+     * starts the thread and waits until the server listens,
+     * returns the port or 0 if listening failed.
+     */
+    quint16 startServer();
+    void stopServer();
+
+    DavServer::Stats stats() const;
+    void resetStats();
+
+protected:
+    void run();
+
+private:
+    QString        _rootDir;
+    DavServer     *_server;
+    quint16        _port;
+    mutable QMutex _mutex;
+    QWaitCondition _ready;
+};
+
+#endif
@@ -0,0 +1,657 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#include <iostream>
+#include <stdio.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QStringList>
+#include <QTextStream>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <QTimer>
+#include <QDebug>
+
+#include "eventstorm.h"
+#include "benchutils.h"
+#include "mirall/folderman.h"
+#include "mirall/folderwatcher.h"
+#include "mirall/mirallconfigfile.h"
+
+/* exit codes of the benchmark */
+#define EXIT_BENCH_OK     0
+#define EXIT_BENCH_ERROR  1
+#define EXIT_USAGE        2
+
+/* the poll timer of the folder must not fire during a run */
+#define STORM_POLL_INTERVAL (3600*1000)
+/* Folder::slotSyncFinished enables the watcher again after that long */
+#define STORM_DEAF_MSEC 2000
+/* bytes written by every create and modify */
+#define STORM_WRITE_SIZE 16
+
+namespace {
+
+static const char usageC[] =
+        "Usage: eventstorm [options]\n"
+        "Creates, modifies, moves and deletes files in a watched tree at given\n"
+        "rates and measures how long the changes take through FolderWatcher,\n"
+        "Folder and the FolderMan scheduling. Prints the results as JSON.\n\n"
+        "Options:\n"
+        "  -h --help            : show this help screen.\n"
+        "  --output <file>      : write the JSON to <file> instead of stdout.\n"
+        "  --workdir <dir>      : directory for the trees, default is a new\n"
+        "                         directory in the temp dir.\n"
+        "  --rates <r,r,...>    : operations per second, default 1000,10000,100000.\n"
+        "  --ops <n>            : operations per run, default 20000.\n"
+        "  --files <n>          : files in the tree before a run, default 2000.\n"
+        "  --dirs <n>           : directories of the tree, default 20.\n"
+        "  --mix <ops>          : comma separated list of create, modify, move\n"
+        "                         and delete, default is all of them.\n"
+        "  --interval <msec>    : event interval of the watcher, default 1000.\n"
+        "  --sync-msec <msec>   : duration of a sync run, default 100.\n"
+        "  --modes <modes>      : normal, overflow or both, default both. In the\n"
+        "                         overflow mode no events are read until all\n"
+        "                         operations are done, the kernel queue overflows\n"
+        "                         if there are more than max_queued_events.\n"
+        "  --keep               : do not remove the work directory.\n"
+        "  --verbose            : print the log output to stderr.\n"
+        ;
+
+bool verbose = false;
+
+void messageHandler( QtMsgType type, const char *msg )
+{
+    if( type == QtDebugMsg && !verbose ) return;
+    fprintf( stderr, "%s\n", msg );
+}
+
+struct RunResult {
+    int    rate;
+    QString mode;
+    double achievedRate;
+    int    generatorErrors;
+    int    ops;
+    int    notifications;
+    int    coalesced;
+    int    overflows;
+    int    overflowCovered;
+    int    dropped;
+    int    syncRuns;
+    qint64 pipelineCpuMsec;
+    qint64 processCpuMsec;
+    int    wallMsec;
+    QVector<qint64> latencies[4];
+};
+
+static const char *stageNamesC[] = { "notify", "evaluate", "schedule", "endToEnd" };
+
+qint64 cpuMsec( int who )
+{
+    struct rusage usage;
+    if( getrusage( who, &usage ) != 0 ) return -1;
+    return qint64(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000
+            + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+}
+
+int maxQueuedEvents()
+{
+    QFile file( QLatin1String("/proc/sys/fs/inotify/max_queued_events") );
+    if( !file.open( QIODevice::ReadOnly ) ) return -1;
+    return file.readAll().trimmed().toInt();
+}
+
+void runEventLoop( int msec )
+{
+    QEventLoop loop;
+    QTimer::singleShot( msec, &loop, SLOT(quit()) );
+    loop.exec();
+}
+
+void writeLatency( QTextStream& out, const char *name, QVector<qint64> samples, bool last )
+{
+    out << "        \"" << name << "\": { \"count\": " << samples.count()
+        << ", \"p50\": " << BenchUtils::percentile( samples, 50 )
+        << ", \"p90\": " << BenchUtils::percentile( samples, 90 )
+        << ", \"p99\": " << BenchUtils::percentile( samples, 99 )
+        << ", \"max\": " << BenchUtils::percentile( samples, 100 )
+        << " }" << (last ? "\n" : ",\n");
+}
+
+void writeRun( QTextStream& out, const RunResult& r )
+{
+    out << "    {\n";
+    out << "      \"rate\": " << r.rate << ",\n";
+    out << "      \"mode\": " << BenchUtils::jsonString( r.mode ) << ",\n";
+    out << "      \"achievedRate\": " << qRound( r.achievedRate ) << ",\n";
+    out << "      \"generatorErrors\": " << r.generatorErrors << ",\n";
+    out << "      \"ops\": " << r.ops << ",\n";
+    out << "      \"notifications\": " << r.notifications << ",\n";
+    out << "      \"coalesced\": " << r.coalesced << ",\n";
+    out << "      \"overflows\": " << r.overflows << ",\n";
+    out << "      \"overflowCovered\": " << r.overflowCovered << ",\n";
+    out << "      \"dropped\": " << r.dropped << ",\n";
+    out << "      \"syncRuns\": " << r.syncRuns << ",\n";
+    out << "      \"wallMsec\": " << r.wallMsec << ",\n";
+    out << "      \"cpuMsec\": { \"pipeline\": " << r.pipelineCpuMsec
+        << ", \"process\": " << r.processCpuMsec << " },\n";
+    out << "      \"latencyUsec\": {\n";
+    for( int i = 0; i < 4; i++ ) {
+        writeLatency( out, stageNamesC[i], r.latencies[i], i == 3 );
+    }
+    out << "      }\n";
+    out << "    }";
+}
+
+/*
+ * one storm against a fresh tree below workDir, the watcher, folder and
+ * scheduler are set up before and torn down after the run.
+ */
+RunResult runStorm( const QString& workDir, int runNo, int rate, bool overflow, int ops,
+                    int files, int dirs, const QList<Mirall::StormGenerator::Operation>& mix,
+                    int interval, int syncMsec )
+{
+    RunResult r;
+    r.rate = rate;
+    r.mode = overflow ? QLatin1String("overflow") : QLatin1String("normal");
+
+    const QString root = QDir( workDir + QString::fromLatin1("/run-%1").arg(runNo) ).absolutePath();
+    QStringList dirList, fileList;
+    for( int i = 0; i < dirs; i++ ) {
+        dirList.append( QString::fromLatin1("d%1").arg(i) );
+        QDir().mkpath( root + QLatin1Char('/') + dirList.last() );
+    }
+    for( int i = 0; i < files; i++ ) {
+        fileList.append( QString::fromLatin1("%1/f%2.dat").arg( dirList.at(i % dirs) ).arg(i) );
+        QFile f( root + QLatin1Char('/') + fileList.last() );
+        f.open( QIODevice::WriteOnly );
+        f.write( QByteArray( STORM_WRITE_SIZE, 'x' ) );
+    }
+
+    Mirall::FolderMan folderMan;
+    Mirall::StormProbe probe( root );
+    const QString alias = QString::fromLatin1("storm-%1").arg(runNo);
+    Mirall::StormFolder *folder = new Mirall::StormFolder( alias, root, &probe, syncMsec );
+    folder->setPollInterval( STORM_POLL_INTERVAL );
+    folder->watcher()->setEventInterval( interval );
+
+    // the probe has to see folderChanged before the folder acts on it.
+    QObject::disconnect( folder->watcher(), SIGNAL(folderChanged(QStringList)),
+                         folder, SLOT(slotChanged(QStringList)) );
+    QObject::connect( folder->watcher(), SIGNAL(folderChanged(QStringList)),
+                      &probe, SLOT(slotFolderChanged(QStringList)) );
+    QObject::connect( folder->watcher(), SIGNAL(folderChanged(QStringList)),
+                      folder, SLOT(slotChanged(QStringList)) );
+    QObject::connect( folder, SIGNAL(scheduleToSync(QString)),
+                      &probe, SLOT(slotScheduleToSync(QString)) );
+    folderMan.registerFolder( folder );
+
+    // the watcher notifies once after its creation, let that pass.
+    runEventLoop( interval + 100 );
+
+    Mirall::StormGenerator generator( root, dirList, fileList, &probe );
+    generator.setOperations( mix );
+    generator.setRate( rate );
+    generator.setCount( ops );
+
+    QTime t;
+    t.start();
+    const qint64 pipelineCpu = cpuMsec( RUSAGE_THREAD );
+    const qint64 processCpu = cpuMsec( RUSAGE_SELF );
+
+    if( overflow ) {
+        // nobody reads the inotify descriptor until the generator is done.
+        generator.start();
+        generator.wait();
+    } else {
+        QEventLoop loop;
+        QObject::connect( &generator, SIGNAL(finished()), &loop, SLOT(quit()) );
+        generator.start();
+        loop.exec();
+    }
+    // all that was seen gets through the event interval, a sync run and
+    // the time the watcher is disabled after it.
+    runEventLoop( interval + syncMsec + STORM_DEAF_MSEC + 1000 );
+
+    r.pipelineCpuMsec = cpuMsec( RUSAGE_THREAD ) - pipelineCpu;
+    r.processCpuMsec  = cpuMsec( RUSAGE_SELF ) - processCpu;
+    r.wallMsec        = t.elapsed();
+
+    r.achievedRate    = generator.achievedRate();
+    r.generatorErrors = generator.errors();
+    r.ops             = probe.ops();
+    r.notifications   = probe.notifications();
+    r.coalesced       = probe.coalesced();
+    r.overflows       = folder->watcher()->overflowCount();
+    r.overflowCovered = probe.overflowCovered();
+    r.dropped         = probe.dropped();
+    r.syncRuns        = probe.syncRuns();
+    r.latencies[0]    = probe.notifyLatency;
+    r.latencies[1]    = probe.evaluateLatency;
+    r.latencies[2]    = probe.scheduleLatency;
+    r.latencies[3]    = probe.endToEndLatency;
+
+    qDebug() << "Storm" << rate << r.mode << ":" << r.ops << "ops," << r.dropped << "dropped,"
+             << r.overflows << "overflows," << r.syncRuns << "sync runs";
+
+    folderMan.unloadAllFolders();
+    BenchUtils::removeTree( root );
+    return r;
+}
+
+}
+
+namespace Mirall {
+
+StormProbe::StormProbe( const QString& root, QObject *parent )
+    : QObject( parent ),
+      _root( root ),
+      _ops(0),
+      _coalesced(0),
+      _overflowCovered(0),
+      _notifications(0),
+      _syncRuns(0),
+      _changedAt(-1),
+      _scheduledAt(-1),
+      _oldestNotifiedOp(-1)
+{
+}
+
+qint64 StormProbe::usecs()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return qint64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+void StormProbe::recordOp( const QString& path )
+{
+    const qint64 now = usecs();
+    QMutexLocker lock( &_mutex );
+    _ops++;
+    if( _pending.contains( path ) ) {
+        _coalesced++;
+    } else {
+        _pending.insert( path, now );
+    }
+}
+
+int StormProbe::ops() const
+{
+    return _ops;
+}
+
+int StormProbe::coalesced() const
+{
+    return _coalesced;
+}
+
+int StormProbe::overflowCovered() const
+{
+    return _overflowCovered;
+}
+
+int StormProbe::notifications() const
+{
+    return _notifications;
+}
+
+int StormProbe::syncRuns() const
+{
+    return _syncRuns;
+}
+
+int StormProbe::dropped()
+{
+    QMutexLocker lock( &_mutex );
+    return _pending.count();
+}
+
+void StormProbe::slotFolderChanged( const QStringList& paths )
+{
+    const qint64 now = usecs();
+    QMutexLocker lock( &_mutex );
+    _notifications++;
+    _changedAt = now;
+
+    qint64 oldest = _oldestNotifiedOp;
+    foreach( const QString& path, paths ) {
+        if( path == _root ) {
+            // an overflow, the sync of the whole folder covers everything.
+            QHash<QString, qint64>::const_iterator it = _pending.constBegin();
+            for( ; it != _pending.constEnd(); ++it ) {
+                if( oldest < 0 || it.value() < oldest ) oldest = it.value();
+            }
+            _overflowCovered += _pending.count();
+            _pending.clear();
+            continue;
+        }
+        QHash<QString, qint64>::iterator it = _pending.find( path );
+        if( it == _pending.end() ) continue;
+        notifyLatency.append( now - it.value() );
+        if( oldest < 0 || it.value() < oldest ) oldest = it.value();
+        _pending.erase( it );
+    }
+    _oldestNotifiedOp = oldest;
+}
+
+void StormProbe::slotScheduleToSync( const QString& )
+{
+    const qint64 now = usecs();
+    if( _changedAt >= 0 ) {
+        evaluateLatency.append( now - _changedAt );
+        _changedAt = -1;
+    }
+    if( _scheduledAt < 0 ) _scheduledAt = now;
+}
+
+void StormProbe::slotSyncStarted()
+{
+    const qint64 now = usecs();
+    _syncRuns++;
+    if( _scheduledAt >= 0 ) {
+        scheduleLatency.append( now - _scheduledAt );
+    }
+    if( _oldestNotifiedOp >= 0 ) {
+        endToEndLatency.append( now - _oldestNotifiedOp );
+    }
+    _scheduledAt = -1;
+    _oldestNotifiedOp = -1;
+}
+
+StormFolder::StormFolder( const QString& alias, const QString& path, StormProbe *probe,
+                          int syncMsec, QObject *parent )
+    : Folder( alias, path, QString::null, parent ),
+      _probe( probe ),
+      _syncMsec( syncMsec ),
+      _busy( false )
+{
+}
+
+FolderWatcher *StormFolder::watcher() const
+{
+    return _watcher;
+}
+
+void StormFolder::startSync( const QStringList& )
+{
+    _busy = true;
+    _probe->slotSyncStarted();
+    emit syncStarted();
+    QTimer::singleShot( _syncMsec, this, SLOT(slotFinishSync()) );
+}
+
+bool StormFolder::isBusy() const
+{
+    return _busy;
+}
+
+void StormFolder::slotTerminateSync()
+{
+    _busy = false;
+}
+
+void StormFolder::slotFinishSync()
+{
+    if( !_busy ) return;
+    _busy = false;
+    _syncResult.setStatus( SyncResult::Success );
+    emit syncFinished( _syncResult );
+}
+
+StormGenerator::StormGenerator( const QString& root, const QStringList& dirs,
+                                const QStringList& files, StormProbe *probe, QObject *parent )
+    : QThread( parent ),
+      _root( root ),
+      _dirs( dirs ),
+      _live( files ),
+      _probe( probe ),
+      _rate( 1000 ),
+      _count( 0 ),
+      _achievedRate( 0 ),
+      _errors( 0 )
+{
+    _operations << Create << Modify << Move << Delete;
+}
+
+void StormGenerator::setOperations( const QList<Operation>& ops )
+{
+    if( !ops.isEmpty() ) _operations = ops;
+}
+
+void StormGenerator::setRate( int opsPerSecond )
+{
+    _rate = qMax( 1, opsPerSecond );
+}
+
+void StormGenerator::setCount( int ops )
+{
+    _count = ops;
+}
+
+double StormGenerator::achievedRate() const
+{
+    return _achievedRate;
+}
+
+int StormGenerator::errors() const
+{
+    return _errors;
+}
+
+QString StormGenerator::absolute( const QString& rel ) const
+{
+    return _root + QLatin1Char('/') + rel;
+}
+
+void StormGenerator::run()
+{
+    const qint64 start = StormProbe::usecs();
+    for( int i = 0; i < _count; i++ ) {
+        // sleeping is too coarse at high rates, only wait when far ahead.
+        const qint64 due = start + qint64(i) * 1000000 / _rate;
+        const qint64 ahead = due - StormProbe::usecs();
+        if( ahead > 1000 ) usleep( ahead );
+
+        if( !doOp( _operations.at( i % _operations.count() ), i ) ) {
+            _errors++;
+        }
+    }
+    const qint64 duration = StormProbe::usecs() - start;
+    _achievedRate = duration > 0 ? _count * 1000000.0 / duration : 0;
+}
+
+bool StormGenerator::doOp( Operation op, int i )
+{
+    // the tree may run empty if only deletes and moves are configured.
+    if( _live.isEmpty() ) op = Create;
+
+    const char data[STORM_WRITE_SIZE] = "eventstorm data";
+    const int idx = i % qMax( 1, _live.count() );
+
+    switch( op ) {
+    case Create: {
+        const QString rel = QString::fromLatin1("%1/s%2.dat").arg( _dirs.at( i % _dirs.count() ) ).arg(i);
+        const QString path = absolute( rel );
+        _probe->recordOp( path );
+        int fd = ::open( QFile::encodeName(path).constData(), O_CREAT | O_WRONLY | O_TRUNC, 0644 );
+        if( fd < 0 ) return false;
+        bool ok = ::write( fd, data, sizeof(data) ) == sizeof(data);
+        ::close( fd );
+        _live.append( rel );
+        return ok;
+    }
+    case Modify: {
+        const QString path = absolute( _live.at(idx) );
+        _probe->recordOp( path );
+        int fd = ::open( QFile::encodeName(path).constData(), O_WRONLY | O_APPEND );
+        if( fd < 0 ) return false;
+        bool ok = ::write( fd, data, sizeof(data) ) == sizeof(data);
+        ::close( fd );
+        return ok;
+    }
+    case Move: {
+        const QString rel = QString::fromLatin1("%1/m%2.dat").arg( _dirs.at( (i+1) % _dirs.count() ) ).arg(i);
+        const QString from = absolute( _live.at(idx) );
+        const QString to = absolute( rel );
+        _probe->recordOp( from );
+        _probe->recordOp( to );
+        _live[idx] = rel;
+        return ::rename( QFile::encodeName(from).constData(), QFile::encodeName(to).constData() ) == 0;
+    }
+    case Delete: {
+        const QString path = absolute( _live.at(idx) );
+        _probe->recordOp( path );
+        _live[idx] = _live.last();
+        _live.removeLast();
+        return ::unlink( QFile::encodeName(path).constData() ) == 0;
+    }
+    }
+    return false;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    qInstallMsgHandler( messageHandler );
+
+    QStringList args = app.arguments();
+    QString outFile, workDir;
+    QList<int> rates;
+    rates << 1000 << 10000 << 100000;
+    QStringList modes;
+    modes << QLatin1String("normal") << QLatin1String("overflow");
+    QList<Mirall::StormGenerator::Operation> mix;
+    int ops = 20000;
+    int files = 2000;
+    int dirs = 20;
+    int interval = 1000;
+    int syncMsec = 100;
+    bool keep = false;
+
+    for( int i = 1; i < args.count(); i++ ) {
+        const QString option = args.at(i);
+        bool hasValue = i+1 < args.count();
+
+        if( option == QLatin1String("-h") || option == QLatin1String("--help") ) {
+            std::cout << usageC;
+            return EXIT_BENCH_OK;
+        } else if( option == QLatin1String("--output") && hasValue ) {
+            outFile = args.at(++i);
+        } else if( option == QLatin1String("--workdir") && hasValue ) {
+            workDir = args.at(++i);
+        } else if( option == QLatin1String("--rates") && hasValue ) {
+            rates.clear();
+            foreach( const QString& rate, args.at(++i).split( QLatin1Char(','), QString::SkipEmptyParts ) ) {
+                if( rate.toInt() > 0 ) rates.append( rate.toInt() );
+            }
+        } else if( option == QLatin1String("--ops") && hasValue ) {
+            ops = args.at(++i).toInt();
+        } else if( option == QLatin1String("--files") && hasValue ) {
+            files = args.at(++i).toInt();
+        } else if( option == QLatin1String("--dirs") && hasValue ) {
+            dirs = qMax( 1, args.at(++i).toInt() );
+        } else if( option == QLatin1String("--mix") && hasValue ) {
+            foreach( const QString& op, args.at(++i).split( QLatin1Char(','), QString::SkipEmptyParts ) ) {
+                if( op == QLatin1String("create") )      mix << Mirall::StormGenerator::Create;
+                else if( op == QLatin1String("modify") ) mix << Mirall::StormGenerator::Modify;
+                else if( op == QLatin1String("move") )   mix << Mirall::StormGenerator::Move;
+                else if( op == QLatin1String("delete") ) mix << Mirall::StormGenerator::Delete;
+                else {
+                    std::cerr << usageC;
+                    return EXIT_USAGE;
+                }
+            }
+        } else if( option == QLatin1String("--interval") && hasValue ) {
+            interval = args.at(++i).toInt();
+        } else if( option == QLatin1String("--sync-msec") && hasValue ) {
+            syncMsec = args.at(++i).toInt();
+        } else if( option == QLatin1String("--modes") && hasValue ) {
+            const QString mode = args.at(++i);
+            modes.clear();
+            if( mode == QLatin1String("both") ) {
+                modes << QLatin1String("normal") << QLatin1String("overflow");
+            } else if( mode == QLatin1String("normal") || mode == QLatin1String("overflow") ) {
+                modes << mode;
+            } else {
+                std::cerr << usageC;
+                return EXIT_USAGE;
+            }
+        } else if( option == QLatin1String("--keep") ) {
+            keep = true;
+        } else if( option == QLatin1String("--verbose") ) {
+            verbose = true;
+        } else {
+            std::cerr << usageC;
+            return EXIT_USAGE;
+        }
+    }
+    if( rates.isEmpty() || ops <= 0 ) {
+        std::cerr << usageC;
+        return EXIT_USAGE;
+    }
+
+    if( workDir.isEmpty() ) {
+        workDir = QDir::tempPath() + QString::fromLatin1("/eventstorm-%1").arg( app.applicationPid() );
+    }
+    if( QFileInfo( workDir ).exists() ) {
+        std::cerr << "The work directory exists already: " << qPrintable(workDir) << std::endl;
+        return EXIT_USAGE;
+    }
+    const QString confDir = workDir + QLatin1String("/conf");
+    QDir().mkpath( confDir );
+    // FolderMan and Folder read their settings from there.
+    Mirall::MirallConfigFile::setConfDir( confDir );
+
+    QList<RunResult> results;
+    int runNo = 0;
+    foreach( int rate, rates ) {
+        foreach( const QString& mode, modes ) {
+            results << runStorm( workDir, runNo++, rate, mode == QLatin1String("overflow"), ops,
+                                 files, dirs, mix, interval, syncMsec );
+        }
+    }
+
+    QFile file;
+    if( outFile.isEmpty() ) {
+        file.open( stdout, QIODevice::WriteOnly | QIODevice::Text );
+    } else {
+        file.setFileName( outFile );
+        if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text ) ) {
+            std::cerr << "Can not write " << qPrintable(outFile) << std::endl;
+            return EXIT_BENCH_ERROR;
+        }
+    }
+
+    QTextStream out( &file );
+    out << "{\n";
+    out << "  \"maxQueuedEvents\": " << maxQueuedEvents() << ",\n";
+    out << "  \"files\": " << files << ",\n";
+    out << "  \"dirs\": " << dirs << ",\n";
+    out << "  \"eventIntervalMsec\": " << interval << ",\n";
+    out << "  \"syncMsec\": " << syncMsec << ",\n";
+    out << "  \"runs\": [\n";
+    for( int i = 0; i < results.count(); i++ ) {
+        writeRun( out, results.at(i) );
+        out << (i+1 < results.count() ? ",\n" : "\n");
+    }
+    out << "  ]\n";
+    out << "}\n";
+    out.flush();
+
+    if( !keep ) {
+        BenchUtils::removeTree( workDir );
+    }
+    return EXIT_BENCH_OK;
+}
@@ -0,0 +1,145 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#ifndef MIRALL_EVENTSTORM_H
+#define MIRALL_EVENTSTORM_H
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+
+#include "mirall/folder.h"
+
+namespace Mirall {
+
+class FolderWatcher;
+
+/**
+ * Timestamps of every stage of the watcher pipeline, in microseconds of
+ * the monotonic clock. recordOp() is called from the generator thread,
+ * everything else from the main thread.
+ */
+class StormProbe : public QObject
+{
+    Q_OBJECT
+public:
+    explicit StormProbe( const QString& root, QObject *parent = 0 );
+
+    static qint64 usecs();
+
+    // a file system operation on path is about to happen
+    void recordOp( const QString& path );
+
+    // the stages, latencies in microseconds
+    QVector<qint64> notifyLatency;    // operation -> folderChanged, per path
+    QVector<qint64> evaluateLatency;  // folderChanged -> scheduleToSync
+    QVector<qint64> scheduleLatency;  // scheduleToSync -> startSync
+    QVector<qint64> endToEndLatency;  // oldest notified operation -> startSync
+
+    int ops() const;
+    int coalesced() const;
+    int overflowCovered() const;
+    int notifications() const;
+    int syncRuns() const;
+    // operations whose path was never notified
+    int dropped();
+
+public slots:
+    void slotFolderChanged( const QStringList& );
+    void slotScheduleToSync( const QString& );
+    void slotSyncStarted();
+
+private:
+    QString _root;
+    QMutex  _mutex;
+    // path -> time of the oldest operation that was not notified yet
+    QHash<QString, qint64> _pending;
+    int     _ops;
+    int     _coalesced;
+    int     _overflowCovered;
+    int     _notifications;
+    int     _syncRuns;
+    qint64  _changedAt;
+    qint64  _scheduledAt;
+    qint64  _oldestNotifiedOp;
+};
+
+/**
+ * A folder without a backend, a sync run only takes the configured time.
+ */
+class StormFolder : public Folder
+{
+    Q_OBJECT
+public:
+    StormFolder( const QString& alias, const QString& path, StormProbe *probe,
+                 int syncMsec, QObject *parent = 0 );
+
+    FolderWatcher *watcher() const;
+
+    virtual void startSync( const QStringList& );
+    virtual bool isBusy() const;
+
+public slots:
+    virtual void slotTerminateSync();
+
+private slots:
+    void slotFinishSync();
+
+private:
+    StormProbe *_probe;
+    int         _syncMsec;
+    bool        _busy;
+};
+
+/**
+ * Creates, modifies, moves and deletes files below a root at a given rate.
+ */
+class StormGenerator : public QThread
+{
+    Q_OBJECT
+public:
+    enum Operation {
+        Create = 0,
+        Modify,
+        Move,
+        Delete
+    };
+
+    StormGenerator( const QString& root, const QStringList& dirs, const QStringList& files,
+                    StormProbe *probe, QObject *parent = 0 );
+
+    void setOperations( const QList<Operation>& );
+    void setRate( int opsPerSecond );
+    void setCount( int ops );
+
+    // the achieved rate of the last run
+    double achievedRate() const;
+    int errors() const;
+
+protected:
+    void run();
+
+private:
+    bool doOp( Operation op, int i );
+    QString absolute( const QString& rel ) const;
+
+    QString          _root;
+    QStringList      _dirs;
+    QStringList      _live;
+    StormProbe      *_probe;
+    QList<Operation> _operations;
+    int              _rate;
+    int              _count;
+    double           _achievedRate;
+    int              _errors;
+};
+
+}
+
+#endif
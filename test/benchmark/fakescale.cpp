@@ -0,0 +1,403 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#include <iostream>
+#include <stdio.h>
+
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QStringList>
+#include <QTextStream>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <QTime>
+#include <QDebug>
+
+#include <csync.h>
+
+#include "benchutils.h"
+#include "fakescale.h"
+#include "fakecsync.h"
+#include "mirall/csyncthread.h"
+#include "mirall/folderman.h"
+#include "mirall/owncloudfolder.h"
+#include "mirall/mirallconfigfile.h"
+#include "mirall/memoryusage.h"
+
+/* exit codes of the benchmark */
+#define EXIT_BENCH_OK     0
+#define EXIT_BENCH_ERROR  1
+#define EXIT_USAGE        2
+
+/* interval of the event loop probe in milliseconds */
+#define PROBE_TICK_MSEC 5
+
+namespace Mirall {
+
+ScaleProbe::ScaleProbe( QObject *parent )
+    : QObject( parent ),
+      _wallMsec(0),
+      _maxStallMsec(0),
+      _syncRuns(0),
+      _items(0),
+      _errors(0)
+{
+    _ticker.setInterval( PROBE_TICK_MSEC );
+    connect( &_ticker, SIGNAL(timeout()), SLOT(slotTick()) );
+}
+
+void ScaleProbe::startRound( const QStringList& aliases )
+{
+    _waiting = aliases.toSet();
+    _wallMsec = 0;
+    _maxStallMsec = 0;
+    _syncRuns = 0;
+    _items = 0;
+    _errors = 0;
+    _round.start();
+    _lastTick.start();
+    _ticker.start();
+}
+
+int ScaleProbe::wallMsec() const
+{
+    return _wallMsec;
+}
+
+int ScaleProbe::maxStallMsec() const
+{
+    return _maxStallMsec;
+}
+
+int ScaleProbe::syncRuns() const
+{
+    return _syncRuns;
+}
+
+qint64 ScaleProbe::items() const
+{
+    return _items;
+}
+
+int ScaleProbe::errors() const
+{
+    return _errors;
+}
+
+void ScaleProbe::slotSyncFinished( const SyncResult& result )
+{
+    Folder *folder = qobject_cast<Folder*>( sender() );
+    if( !folder || _waiting.isEmpty() ) return;
+
+    // a poll timer may sync a folder twice in a round, all runs count
+    _syncRuns++;
+    _items += result.syncFileItemVector().count();
+    _errors += result.errorStrings().count();
+    _waiting.remove( folder->alias() );
+    if( _waiting.isEmpty() ) {
+        _wallMsec = _round.elapsed();
+        _ticker.stop();
+        emit roundFinished();
+    }
+}
+
+void ScaleProbe::slotTick()
+{
+    _maxStallMsec = qMax( _maxStallMsec, _lastTick.restart() - PROBE_TICK_MSEC );
+}
+
+}
+
+namespace {
+
+static const char usageC[] =
+        "Usage: fakescale [options]\n"
+        "Runs the sync core on the csync test double with synthesised trees,\n"
+        "without files and without a server, and reports the timings, the\n"
+        "memory and the longest block of the main event loop as JSON.\n\n"
+        "Options:\n"
+        "  -h --help            : show this help screen.\n"
+        "  --output <file>      : write the JSON to <file> instead of stdout.\n"
+        "  --mode <mode>        : thread runs CSyncThread alone, folderman runs\n"
+        "                         ownCloudFolders scheduled by FolderMan.\n"
+        "                         Default is folderman.\n"
+        "  --files <n>          : files per folder, default 1000000.\n"
+        "  --folders <n>        : number of folders in folderman mode, default 1.\n"
+        "  --runs <n>           : sync rounds, default 3.\n"
+        "  --fake <config>      : settings of the test double, e.g.\n"
+        "                         \"newRemote=0.05,propagateUsecPerFile=10\".\n"
+        "  --workdir <dir>      : directory for the configuration and the empty\n"
+        "                         folders, default is a new one in the temp dir.\n"
+        "  --verbose            : print the log output to stderr.\n"
+        ;
+
+bool verbose = false;
+
+void messageHandler( QtMsgType type, const char *msg )
+{
+    if( type == QtDebugMsg && !verbose ) return;
+    fprintf( stderr, "%s\n", msg );
+}
+
+void writeHash( QTextStream& out, const QHash<QString, qint64>& hash )
+{
+    QStringList keys = hash.keys();
+    keys.sort();
+    out << "{";
+    for( int i = 0; i < keys.count(); i++ ) {
+        out << (i ? ", " : " ") << BenchUtils::jsonString( keys.at(i) ) << ": " << hash.value( keys.at(i) );
+    }
+    out << " }";
+}
+
+void addUp( QHash<QString, qint64> *sum, const QHash<QString, qint64>& values )
+{
+    QHash<QString, qint64>::const_iterator it = values.constBegin();
+    for( ; it != values.constEnd(); ++it ) {
+        (*sum)[it.key()] += it.value();
+    }
+}
+
+QHash<QString, qint64> toInt64( const QHash<QString, int>& phases )
+{
+    QHash<QString, qint64> re;
+    QHash<QString, int>::const_iterator it = phases.constBegin();
+    for( ; it != phases.constEnd(); ++it ) {
+        re.insert( it.key(), it.value() );
+    }
+    return re;
+}
+
+/*
+ * CSyncThread alone, like memscale: startSync runs in the main thread, the
+ * previous thread object is deleted when the next run starts.
+ */
+bool runThread( int runs, QTextStream& out )
+{
+    CSYNC *ctx = 0;
+    if( csync_create( &ctx, "/fake/local", "owncloud://fake/remote" ) < 0 || csync_init( ctx ) < 0 ) {
+        std::cerr << "Unable to create the csync context" << std::endl;
+        return false;
+    }
+
+    bool ok = true;
+    Mirall::CSyncThread *thread = 0;
+    out << "  \"runs\": [\n";
+    for( int r = 0; r < runs; r++ ) {
+        delete thread;
+        Mirall::MemoryUsage::resetPeakResident();
+
+        QTime t;
+        t.start();
+        thread = new Mirall::CSyncThread( ctx );
+        Mirall::BenchSyncObserver observer;
+        QObject::connect( thread, SIGNAL(csyncError(QString)),
+                          &observer, SLOT(slotCSyncError(QString)) );
+        QObject::connect( thread, SIGNAL(phaseTime(QString,int)),
+                          &observer, SLOT(slotPhaseTime(QString,int)) );
+        QObject::connect( thread, SIGNAL(transferProgress(int,qint64,qint64)),
+                          &observer, SLOT(slotTransferProgress(int,qint64,qint64)) );
+        QObject::connect( thread, SIGNAL(treeWalkResult(SyncFileItemVector)),
+                          &observer, SLOT(slotTreeWalkResult(SyncFileItemVector)) );
+        QObject::connect( thread, SIGNAL(aboutToRemoveAllFiles(SyncFileItem::Direction,bool*)),
+                          &observer, SLOT(slotAboutToRemoveAllFiles(SyncFileItem::Direction,bool*)) );
+        thread->startSync();
+        const int wallMsec = t.elapsed();
+
+        Mirall::SyncResult result = observer.result();
+        Mirall::SyncFileItemVector items = result.syncFileItemVector();
+        ok = ok && result.errorStrings().isEmpty();
+
+        out << "    { \"wallMsec\": " << wallMsec
+            << ", \"items\": " << items.count()
+            << ", \"transferred\": " << result.transferredFiles()
+            << ", \"errors\": " << result.errorStrings().count()
+            << ", \"peakRss\": " << Mirall::MemoryUsage::peakResidentBytes()
+            << ",\n      \"phases\": ";
+        writeHash( out, toInt64( result.phaseTimes() ) );
+        out << ",\n      \"components\": ";
+        writeHash( out, thread->memoryUsage( items ) );
+        out << " }" << (r+1 < runs ? ",\n" : "\n");
+    }
+    out << "  ],\n";
+
+    delete thread;
+    csync_destroy( ctx );
+    return ok;
+}
+
+/*
+ * ownCloudFolders with the test double behind, registered at FolderMan and
+ * scheduled all at once in every round.
+ */
+bool runFolderMan( int folders, int runs, const QString& workDir, QTextStream& out )
+{
+    MirallConfigFile::setConfDir( workDir + QLatin1String("/conf") );
+
+    Mirall::FolderMan folderMan;
+    Mirall::ScaleProbe probe;
+    QStringList aliases;
+    for( int f = 0; f < folders; f++ ) {
+        const QString alias = QString::fromLatin1("fake%1").arg( f );
+        const QString path = workDir + QLatin1Char('/') + alias + QLatin1Char('/');
+        QDir().mkpath( path );
+        Mirall::Folder *folder = new Mirall::ownCloudFolder( alias, path, QLatin1String("/") + alias );
+        QObject::connect( folder, SIGNAL(syncFinished(SyncResult)),
+                          &probe, SLOT(slotSyncFinished(SyncResult)) );
+        folderMan.registerFolder( folder );
+        aliases << alias;
+    }
+
+    bool ok = true;
+    out << "  \"runs\": [\n";
+    for( int r = 0; r < runs; r++ ) {
+        Mirall::MemoryUsage::resetPeakResident();
+        probe.startRound( aliases );
+        QEventLoop loop;
+        QObject::connect( &probe, SIGNAL(roundFinished()), &loop, SLOT(quit()) );
+        folderMan.slotScheduleAllFolders();
+        loop.exec();
+
+        QHash<QString, qint64> phases;
+        QHash<QString, qint64> memory;
+        foreach( Mirall::Folder *folder, folderMan.map() ) {
+            const Mirall::SyncResult result = folder->syncResult();
+            addUp( &phases, toInt64( result.phaseTimes() ) );
+            addUp( &memory, result.memoryUsage() );
+        }
+        ok = ok && probe.errors() == 0;
+
+        out << "    { \"wallMsec\": " << probe.wallMsec()
+            << ", \"syncRuns\": " << probe.syncRuns()
+            << ", \"items\": " << probe.items()
+            << ", \"errors\": " << probe.errors()
+            << ", \"maxStallMsec\": " << probe.maxStallMsec()
+            << ", \"avgScheduleWaitMsec\": " << folderMan.averageScheduleWaitTime()
+            << ", \"peakRss\": " << Mirall::MemoryUsage::peakResidentBytes()
+            << ",\n      \"phasesSum\": ";
+        writeHash( out, phases );
+        out << ",\n      \"components\": ";
+        writeHash( out, memory );
+        out << " }" << (r+1 < runs ? ",\n" : "\n");
+    }
+    out << "  ],\n";
+    return ok;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    qInstallMsgHandler( messageHandler );
+
+    QStringList args = app.arguments();
+    QString outFile, workDir, fakeConfig;
+    QString mode = QLatin1String("folderman");
+    int files = 1000000;
+    int folders = 1;
+    int runs = 3;
+
+    for( int i = 1; i < args.count(); i++ ) {
+        const QString option = args.at(i);
+        bool hasValue = i+1 < args.count();
+
+        if( option == QLatin1String("-h") || option == QLatin1String("--help") ) {
+            std::cout << usageC;
+            return EXIT_BENCH_OK;
+        } else if( option == QLatin1String("--output") && hasValue ) {
+            outFile = args.at(++i);
+        } else if( option == QLatin1String("--mode") && hasValue ) {
+            mode = args.at(++i);
+        } else if( option == QLatin1String("--files") && hasValue ) {
+            files = args.at(++i).toInt();
+        } else if( option == QLatin1String("--folders") && hasValue ) {
+            folders = args.at(++i).toInt();
+        } else if( option == QLatin1String("--runs") && hasValue ) {
+            runs = args.at(++i).toInt();
+        } else if( option == QLatin1String("--fake") && hasValue ) {
+            fakeConfig = args.at(++i);
+        } else if( option == QLatin1String("--workdir") && hasValue ) {
+            workDir = args.at(++i);
+        } else if( option == QLatin1String("--verbose") ) {
+            verbose = true;
+        } else {
+            std::cerr << usageC;
+            return EXIT_USAGE;
+        }
+    }
+
+    if( files <= 0 || folders <= 0 || runs <= 0 ||
+        (mode != QLatin1String("thread") && mode != QLatin1String("folderman")) ) {
+        std::cerr << usageC;
+        return EXIT_USAGE;
+    }
+
+    FakeCSync::Config cfg = FakeCSync::config();
+    QString error;
+    if( !FakeCSync::parseConfig( fakeConfig, &cfg, &error ) ) {
+        std::cerr << "--fake: " << qPrintable( error ) << std::endl;
+        return EXIT_USAGE;
+    }
+    cfg.files = files;
+    FakeCSync::setConfig( cfg );
+    FakeCSync::resetStats();
+
+    bool removeWorkDir = false;
+    if( mode == QLatin1String("folderman") ) {
+        if( workDir.isEmpty() ) {
+            workDir = QDir::tempPath() + QString::fromLatin1("/fakescale-%1").arg( app.applicationPid() );
+            removeWorkDir = true;
+        }
+        if( QFileInfo( workDir ).exists() ) {
+            std::cerr << "The work directory exists already: " << qPrintable(workDir) << std::endl;
+            return EXIT_USAGE;
+        }
+    }
+
+    QFile file;
+    if( outFile.isEmpty() ) {
+        file.open( stdout, QIODevice::WriteOnly | QIODevice::Text );
+    } else {
+        file.setFileName( outFile );
+        if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text ) ) {
+            std::cerr << "Can not write " << qPrintable(outFile) << std::endl;
+            return EXIT_BENCH_ERROR;
+        }
+    }
+
+    QTextStream out( &file );
+    out << "{\n";
+    out << "  \"mode\": " << BenchUtils::jsonString( mode ) << ",\n";
+    out << "  \"files\": " << files << ",\n";
+    out << "  \"folders\": " << (mode == QLatin1String("thread") ? 1 : folders) << ",\n";
+    out << "  \"fake\": " << BenchUtils::jsonString( fakeConfig ) << ",\n";
+
+    bool ok;
+    if( mode == QLatin1String("thread") ) {
+        ok = runThread( runs, out );
+    } else {
+        ok = runFolderMan( folders, runs, workDir, out );
+    }
+
+    const FakeCSync::Stats stats = FakeCSync::stats();
+    out << "  \"backend\": { \"runs\": " << stats.runs
+        << ", \"failedRuns\": " << stats.failedRuns
+        << ", \"walkedNodes\": " << stats.walkedNodes
+        << ", \"uploads\": " << stats.uploads
+        << ", \"downloads\": " << stats.downloads
+        << ", \"removes\": " << stats.removes
+        << ", \"renames\": " << stats.renames
+        << ", \"fileErrors\": " << stats.fileErrors << " }\n";
+    out << "}\n";
+    out.flush();
+
+    if( removeWorkDir ) {
+        BenchUtils::removeTree( workDir );
+    }
+    return ok ? EXIT_BENCH_OK : EXIT_BENCH_ERROR;
+}
@@ -0,0 +1,62 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#ifndef MIRALL_FAKESCALE_H
+#define MIRALL_FAKESCALE_H
+
+#include <QObject>
+#include <QSet>
+#include <QTime>
+#include <QTimer>
+
+#include "mirall/syncresult.h"
+
+namespace Mirall {
+
+/**
+ * Watches the folders of one round: every folder has to finish a sync
+ * once. Measures how long the event loop of the main thread was blocked
+ * in the meantime, that is where the results are processed and where the
+ * UI would freeze.
+ */
+class ScaleProbe : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ScaleProbe( QObject *parent = 0 );
+
+    void startRound( const QStringList& aliases );
+
+    int    wallMsec() const;
+    int    maxStallMsec() const;
+    int    syncRuns() const;
+    qint64 items() const;
+    int    errors() const;
+
+signals:
+    void roundFinished();
+
+public slots:
+    void slotSyncFinished( const SyncResult& );
+
+private slots:
+    void slotTick();
+
+private:
+    QSet<QString> _waiting;
+    QTimer        _ticker;
+    QTime         _round;
+    QTime         _lastTick;
+    int           _wallMsec;
+    int           _maxStallMsec;
+    int           _syncRuns;
+    qint64        _items;
+    int           _errors;
+};
+
+}
+
+#endif
@@ -0,0 +1,339 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#include <iostream>
+#include <stdio.h>
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+#include <QProcess>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <QTime>
+#include <QDebug>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include <csync.h>
+
+#include "benchutils.h"
+#include "mirall/csyncthread.h"
+#include "mirall/memoryusage.h"
+
+/* exit codes of the benchmark */
+#define EXIT_BENCH_OK     0
+#define EXIT_BENCH_ERROR  1
+#define EXIT_USAGE        2
+
+/* files per directory of the generated trees */
+#define FILES_PER_DIR 1000
+
+namespace {
+
+static const char usageC[] =
+        "Usage: memscale [options]\n"
+        "Syncs generated trees of growing size from one local directory into\n"
+        "another and reports the peak and steady resident size of the process\n"
+        "and the estimates of MemoryUsage per component as JSON. Every size\n"
+        "runs in a process of its own.\n\n"
+        "Options:\n"
+        "  -h --help            : show this help screen.\n"
+        "  --output <file>      : write the JSON to <file> instead of stdout.\n"
+        "  --workdir <dir>      : directory for the trees, default is a new\n"
+        "                         directory in the temp dir.\n"
+        "  --sizes <n,n,...>    : number of files, default 1000,10000,100000.\n"
+        "  --keep               : do not remove the work directory.\n"
+        "  --verbose            : print the log output to stderr.\n"
+        ;
+
+bool verbose = false;
+
+void messageHandler( QtMsgType type, const char *msg )
+{
+    if( type == QtDebugMsg && !verbose ) return;
+    fprintf( stderr, "%s\n", msg );
+}
+
+void csyncLogCatcher( CSYNC *ctx, int verbosity, const char *function,
+                      const char *buffer, void *userdata )
+{
+    Q_UNUSED(ctx); Q_UNUSED(verbosity); Q_UNUSED(function); Q_UNUSED(userdata);
+    if( verbose ) {
+        fprintf( stderr, "%s\n", buffer );
+    }
+}
+
+// the resident size without the memory the allocator keeps for reuse
+qint64 heldResidentBytes()
+{
+#ifdef __GLIBC__
+    malloc_trim( 0 );
+#endif
+    return Mirall::MemoryUsage::residentBytes();
+}
+
+void writeUsage( QTextStream& out, const QHash<QString, qint64>& usage )
+{
+    QStringList components = usage.keys();
+    components.sort();
+    out << "{";
+    for( int i = 0; i < components.count(); i++ ) {
+        out << (i ? ", " : " ") << BenchUtils::jsonString( components.at(i) ) << ": "
+            << usage.value( components.at(i) );
+    }
+    out << " }";
+}
+
+/*
+ * One run like ownCloudFolder does it: the CSyncThread of the previous run
+ * is deleted when the next one starts, the result is kept by the folder.
+ */
+bool runSync( CSYNC *ctx, const QString& localDir, Mirall::CSyncThread **thread,
+              Mirall::SyncResult *result, QTextStream& out, const char *name )
+{
+    delete *thread;
+    *thread = 0;
+    *result = Mirall::SyncResult();
+    heldResidentBytes();
+    Mirall::MemoryUsage::resetPeakResident();
+
+    QTime t;
+    t.start();
+    *thread = new Mirall::CSyncThread( ctx );
+    (*thread)->setLocalPath( localDir );
+    Mirall::BenchSyncObserver observer;
+    QObject::connect( *thread, SIGNAL(csyncError(QString)),
+                      &observer, SLOT(slotCSyncError(QString)) );
+    QObject::connect( *thread, SIGNAL(phaseTime(QString,int)),
+                      &observer, SLOT(slotPhaseTime(QString,int)) );
+    QObject::connect( *thread, SIGNAL(treeWalkResult(SyncFileItemVector)),
+                      &observer, SLOT(slotTreeWalkResult(SyncFileItemVector)) );
+    QObject::connect( *thread, SIGNAL(aboutToRemoveAllFiles(SyncFileItem::Direction,bool*)),
+                      &observer, SLOT(slotAboutToRemoveAllFiles(SyncFileItem::Direction,bool*)) );
+    (*thread)->startSync();
+    const int wallMsec = t.elapsed();
+    *result = observer.result();
+
+    const qint64 peak = Mirall::MemoryUsage::peakResidentBytes();
+    const qint64 steady = heldResidentBytes();
+    Mirall::SyncFileItemVector items = result->syncFileItemVector();
+    QHash<QString, qint64> usage = (*thread)->memoryUsage( items );
+    usage.insert( QLatin1String("syncResultItems"), Mirall::MemoryUsage::itemVectorBytes( items ) );
+
+    out << "  \"" << name << "\": {\n";
+    out << "    \"wallMsec\": " << wallMsec << ",\n";
+    out << "    \"items\": " << items.count() << ",\n";
+    out << "    \"errors\": " << result->errorStrings().count() << ",\n";
+    out << "    \"peakRss\": " << peak << ",\n";
+    out << "    \"steadyRss\": " << steady << ",\n";
+    out << "    \"components\": ";
+    writeUsage( out, usage );
+    out << "\n  }";
+    return result->errorStrings().isEmpty();
+}
+
+/*
+ * the child: creates a tree of the given size and syncs it twice, prints
+ * one JSON object.
+ */
+int runSize( int files, const QString& workDir )
+{
+    const QString localDir  = workDir + QLatin1String("/local");
+    const QString remoteDir = workDir + QLatin1String("/remote");
+    const QString confDir   = workDir + QLatin1String("/conf");
+    foreach( const QString& dir, QStringList() << localDir << remoteDir << confDir ) {
+        QDir().mkpath( dir );
+    }
+
+    QFile file;
+    file.open( stdout, QIODevice::WriteOnly | QIODevice::Text );
+    QTextStream out( &file );
+    out << "{\n";
+    out << "  \"files\": " << files << ",\n";
+    out << "  \"baselineRss\": " << heldResidentBytes() << ",\n";
+
+    QTime t;
+    t.start();
+    for( int i = 0; i < files; i++ ) {
+        if( i % FILES_PER_DIR == 0 ) {
+            QDir().mkpath( QString::fromLatin1("%1/d%2").arg( localDir ).arg( i / FILES_PER_DIR ) );
+        }
+        QFile f( QString::fromLatin1("%1/d%2/f%3.dat").arg( localDir ).arg( i / FILES_PER_DIR ).arg( i ) );
+        if( !f.open( QIODevice::WriteOnly ) ) {
+            std::cerr << "Can not create " << qPrintable( f.fileName() ) << std::endl;
+            return EXIT_BENCH_ERROR;
+        }
+        f.write( "x", 1 );
+    }
+    out << "  \"createMsec\": " << t.elapsed() << ",\n";
+
+    CSYNC *ctx = 0;
+    if( csync_create( &ctx, localDir.toUtf8().data(), remoteDir.toUtf8().data() ) < 0 ) {
+        std::cerr << "Unable to create csync-context" << std::endl;
+        return EXIT_BENCH_ERROR;
+    }
+    csync_set_log_callback( ctx, csyncLogCatcher );
+    csync_set_log_verbosity( ctx, verbose ? 11 : 0 );
+    csync_set_config_dir( ctx, confDir.toUtf8() );
+    if( csync_init( ctx ) < 0 ) {
+        std::cerr << qPrintable( Mirall::CSyncThread::csyncErrorToString( csync_get_error(ctx),
+                                                                          csync_get_error_string(ctx) ) )
+                  << std::endl;
+        csync_destroy( ctx );
+        return EXIT_BENCH_ERROR;
+    }
+
+    Mirall::CSyncThread *thread = 0;
+    Mirall::SyncResult result;
+    bool ok = runSync( ctx, localDir, &thread, &result, out, "initial" );
+    out << ",\n";
+    ok = runSync( ctx, localDir, &thread, &result, out, "resync" ) && ok;
+    out << "\n}\n";
+    out.flush();
+
+    delete thread;
+    csync_destroy( ctx );
+    return ok ? EXIT_BENCH_OK : EXIT_BENCH_ERROR;
+}
+
+// growth of a field per file between the smallest and the largest size
+qint64 bytesPerFile( const QList<int>& sizes, const QList<QByteArray>& runs,
+                     const QByteArray& run, const QByteArray& field )
+{
+    QList<qint64> values;
+    foreach( const QByteArray& json, runs ) {
+        // the children print one field per line, no JSON parser needed.
+        int start = json.indexOf( "\"" + run + "\"" );
+        int pos = json.indexOf( "\"" + field + "\": ", start );
+        if( start < 0 || pos < 0 ) return -1;
+        pos += field.length() + 4;
+        values << json.mid( pos, json.indexOf( ',', pos ) - pos ).trimmed().toLongLong();
+    }
+    if( values.count() < 2 || sizes.last() == sizes.first() ) return -1;
+    return (values.last() - values.first()) / (sizes.last() - sizes.first());
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    qInstallMsgHandler( messageHandler );
+
+    QStringList args = app.arguments();
+    QString outFile, workDir;
+    QList<int> sizes;
+    sizes << 1000 << 10000 << 100000;
+    int child = 0;
+    bool keep = false;
+
+    for( int i = 1; i < args.count(); i++ ) {
+        const QString option = args.at(i);
+        bool hasValue = i+1 < args.count();
+
+        if( option == QLatin1String("-h") || option == QLatin1String("--help") ) {
+            std::cout << usageC;
+            return EXIT_BENCH_OK;
+        } else if( option == QLatin1String("--output") && hasValue ) {
+            outFile = args.at(++i);
+        } else if( option == QLatin1String("--workdir") && hasValue ) {
+            workDir = args.at(++i);
+        } else if( option == QLatin1String("--sizes") && hasValue ) {
+            sizes.clear();
+            foreach( const QString& size, args.at(++i).split( QLatin1Char(','), QString::SkipEmptyParts ) ) {
+                if( size.toInt() > 0 ) sizes.append( size.toInt() );
+            }
+            qSort( sizes );
+        } else if( option == QLatin1String("--child") && hasValue ) {
+            // internal, one size in this process
+            child = args.at(++i).toInt();
+        } else if( option == QLatin1String("--keep") ) {
+            keep = true;
+        } else if( option == QLatin1String("--verbose") ) {
+            verbose = true;
+        } else {
+            std::cerr << usageC;
+            return EXIT_USAGE;
+        }
+    }
+
+    if( child > 0 ) {
+        return runSize( child, workDir );
+    }
+    if( sizes.isEmpty() ) {
+        std::cerr << usageC;
+        return EXIT_USAGE;
+    }
+
+    if( workDir.isEmpty() ) {
+        workDir = QDir::tempPath() + QString::fromLatin1("/memscale-%1").arg( app.applicationPid() );
+    }
+    if( QFileInfo( workDir ).exists() ) {
+        std::cerr << "The work directory exists already: " << qPrintable(workDir) << std::endl;
+        return EXIT_USAGE;
+    }
+
+    QList<QByteArray> runs;
+    int exitCode = EXIT_BENCH_OK;
+    foreach( int size, sizes ) {
+        const QString sizeDir = workDir + QString::fromLatin1("/size-%1").arg( size );
+        QStringList childArgs;
+        childArgs << QLatin1String("--child") << QString::number( size )
+                  << QLatin1String("--workdir") << sizeDir;
+        if( verbose ) childArgs << QLatin1String("--verbose");
+
+        QProcess process;
+        process.setProcessChannelMode( QProcess::ForwardedErrorChannel );
+        process.start( app.applicationFilePath(), childArgs );
+        process.waitForFinished( -1 );
+        if( process.exitStatus() != QProcess::NormalExit || process.exitCode() != EXIT_BENCH_OK ) {
+            std::cerr << "The run with " << size << " files failed." << std::endl;
+            exitCode = EXIT_BENCH_ERROR;
+            runs << QByteArray("    null");
+        } else {
+            runs << process.readAllStandardOutput().trimmed();
+        }
+        if( !keep ) {
+            BenchUtils::removeTree( sizeDir );
+        }
+    }
+
+    QFile file;
+    if( outFile.isEmpty() ) {
+        file.open( stdout, QIODevice::WriteOnly | QIODevice::Text );
+    } else {
+        file.setFileName( outFile );
+        if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text ) ) {
+            std::cerr << "Can not write " << qPrintable(outFile) << std::endl;
+            return EXIT_BENCH_ERROR;
+        }
+    }
+
+    QTextStream out( &file );
+    out << "{\n";
+    out << "  \"bytesPerFile\": {\n";
+    out << "    \"initialPeak\": " << bytesPerFile( sizes, runs, "initial", "peakRss" ) << ",\n";
+    out << "    \"initialSteady\": " << bytesPerFile( sizes, runs, "initial", "steadyRss" ) << ",\n";
+    out << "    \"resyncPeak\": " << bytesPerFile( sizes, runs, "resync", "peakRss" ) << ",\n";
+    out << "    \"resyncSteady\": " << bytesPerFile( sizes, runs, "resync", "steadyRss" ) << "\n";
+    out << "  },\n";
+    out << "  \"runs\": [\n";
+    for( int i = 0; i < runs.count(); i++ ) {
+        out << QString::fromUtf8( runs.at(i) ) << (i+1 < runs.count() ? ",\n" : "\n");
+    }
+    out << "  ]\n";
+    out << "}\n";
+    out.flush();
+
+    if( !keep ) {
+        BenchUtils::removeTree( workDir );
+    }
+    return exitCode;
+}
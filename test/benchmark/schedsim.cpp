@@ -0,0 +1,663 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#include <iostream>
+#include <math.h>
+#include <stdio.h>
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+#include <QFile>
+#include <QTime>
+#include <QDebug>
+
+#include "benchutils.h"
+#include "schedsim.h"
+#include "mirall/folderman.h"
+#include "mirall/folderwatcher.h"
+
+/* exit codes of the simulator */
+#define EXIT_SIM_OK     0
+#define EXIT_SIM_ERROR  1
+#define EXIT_USAGE      2
+
+/* the remote poll interval of MirallConfigFile without configuration */
+#define DEFAULT_POLL_INTERVAL_MSEC 30000
+
+namespace Mirall {
+
+SimPolicy::SimPolicy()
+    : pollIntervalMsec(DEFAULT_POLL_INTERVAL_MSEC),
+      pollJitter(true),
+      syncGapMsec(SYNC_GAP_MSEC),
+      eventIntervalMsec(DEFAULT_EVENT_INTERVAL_MSEC),
+      reenableDelayMsec(WATCHER_REENABLE_DELAY_MSEC),
+      agingIntervalMsec(SyncScheduler().agingInterval()),
+      watcherBackoff(false),
+      initialSync(true)
+{
+}
+
+SimCost::SimCost()
+    : runMsec(2000),
+      changeMsec(200),
+      requestsPerRun(1),
+      errorRate(0.0)
+{
+}
+
+SchedulerSim::SchedulerSim( int folders, const SimPolicy& policy, const SimCost& cost, unsigned seed )
+    : _policy( policy ),
+      _cost( cost ),
+      _random( seed ? seed : 1 ),
+      _currentFolder( -1 ),
+      _now( 0 ),
+      _duration( 0 ),
+      _outageUntil( -1 ),
+      _sequence( 0 ),
+      _processedEvents( 0 ),
+      _runs( 0 ),
+      _failedRuns( 0 ),
+      _emptyRuns( 0 ),
+      _droppedRequests( 0 ),
+      _eventsWhileDisabled( 0 ),
+      _requests( 0 ),
+      _busyMsec( 0 ),
+      _maxQueueDepth( 0 )
+{
+    _runsByReason[0] = _runsByReason[1] = _runsByReason[2] = 0;
+    _scheduler.setAgingInterval( policy.agingIntervalMsec );
+
+    _folders.resize( folders );
+    for( int f = 0; f < folders; f++ ) {
+        FolderState& s = _folders[f];
+        s.alias = QString::fromLatin1("folder%1").arg( f );
+        s.pollBase = policy.pollJitter ? Folder::jitteredPollInterval( policy.pollIntervalMsec, random() )
+                                       : policy.pollIntervalMsec;
+        s.pollInterval = s.pollBase;
+        s.pollGeneration = 0;
+        s.eventInterval = policy.eventIntervalMsec;
+        s.eventsEnabled = true;
+        s.eventsPending = false;
+        s.processGeneration = 0;
+        s.errorCount = 0;
+        s.lastRunDownloaded = false;
+        s.reason = Folder::Poll;
+        s.coveredLocal = 0;
+        s.coveredRemote = 0;
+        s.runFails = false;
+        _folderIndex.insert( s.alias, f );
+    }
+}
+
+double SchedulerSim::random()
+{
+    // xorshift, the runs have to be repeatable
+    _random ^= _random << 13;
+    _random ^= _random >> 17;
+    _random ^= _random << 5;
+    return _random / 4294967296.0;
+}
+
+void SchedulerSim::post( qint64 at, EventType type, int folder, int generation, int traceIndex )
+{
+    Event e;
+    e.type = type;
+    e.folder = folder;
+    e.generation = generation;
+    e.traceIndex = traceIndex;
+    // events at the same time keep their order, like timers of equal timeout
+    _events.insert( qMakePair( at, _sequence++ ), e );
+}
+
+void SchedulerSim::run( const QList<SimChange>& trace, qint64 durationMsec )
+{
+    _trace = trace;
+    _duration = durationMsec;
+    for( int i = 0; i < _trace.count(); i++ ) {
+        post( _trace.at(i).msec, TraceEvent, _trace.at(i).folder, 0, i );
+    }
+
+    // the constructor of Folder starts the poll timer
+    for( int f = 0; f < _folders.count(); f++ ) {
+        startPollTimer( f );
+    }
+    if( _policy.initialSync ) {
+        for( int f = 0; f < _folders.count(); f++ ) {
+            slotScheduleSync( f );
+        }
+    }
+
+    while( !_events.isEmpty() ) {
+        QMap<QPair<qint64, quint64>, Event>::iterator it = _events.begin();
+        if( it.key().first > _duration ) break;
+        _now = it.key().first;
+        const Event e = it.value();
+        _events.erase( it );
+        _processedEvents++;
+
+        switch( e.type ) {
+        case TraceEvent:
+            applyTrace( _trace.at( e.traceIndex ) );
+            break;
+        case PollTimeout:
+            if( e.generation == _folders[e.folder].pollGeneration ) {
+                slotPollTimerTimeout( e.folder );
+            }
+            break;
+        case WatcherTimeout:
+            slotProcessTimerTimeout( e.folder, e.generation );
+            break;
+        case WatcherEnable:
+            setEventsEnabled( e.folder );
+            break;
+        case SyncDone:
+            slotSyncFinished( e.folder );
+            break;
+        case ScheduleNext:
+            slotScheduleFolderSync();
+            break;
+        }
+    }
+    _now = _duration;
+}
+
+void SchedulerSim::applyTrace( const SimChange& change )
+{
+    if( change.kind == SimChange::Outage ) {
+        _outageUntil = qMax( _outageUntil, change.msec + change.duration );
+        return;
+    }
+    if( change.folder < 0 || change.folder >= _folders.count() ) return;
+
+    FolderState& s = _folders[change.folder];
+    for( int i = 0; i < change.count; i++ ) {
+        if( change.kind == SimChange::Local ) {
+            s.localChanges.append( change.msec );
+        } else {
+            s.remoteChanges.append( change.msec );
+        }
+    }
+    // the server is only asked by a sync run
+    if( change.kind == SimChange::Local ) {
+        if( s.eventsEnabled ) {
+            changeDetected( change.folder );
+        } else {
+            _eventsWhileDisabled += change.count;
+        }
+    }
+}
+
+/*
+ * Folder
+ */
+
+void SchedulerSim::evaluateSync( int folder, Folder::SyncReason reason )
+{
+    FolderState& s = _folders[folder];
+    s.pollGeneration++;   // _pollTimer->stop()
+    s.reason = reason;
+    slotScheduleSync( folder );
+}
+
+void SchedulerSim::startPollTimer( int folder )
+{
+    FolderState& s = _folders[folder];
+    post( _now + s.pollInterval, PollTimeout, folder, ++s.pollGeneration );
+}
+
+void SchedulerSim::slotPollTimerTimeout( int folder )
+{
+    FolderState& s = _folders[folder];
+    // _watcher->clearPendingEvents()
+    s.eventsPending = false;
+    s.processGeneration++;
+    evaluateSync( folder, s.lastRunDownloaded ? Folder::RemoteChange : Folder::Poll );
+}
+
+void SchedulerSim::startSync( int folder )
+{
+    FolderState& s = _folders[folder];
+    // slotSyncStarted() disables the watcher, that stops its timer
+    s.eventsEnabled = false;
+    s.processGeneration++;
+
+    // a run sees everything that changed until it starts
+    s.coveredLocal = s.localChanges.count();
+    s.coveredRemote = s.remoteChanges.count();
+    s.runFails = _now < _outageUntil || random() < _cost.errorRate;
+
+    const int changes = s.coveredLocal + s.coveredRemote;
+    qint64 msec = _cost.runMsec;
+    qint64 requests = _cost.requestsPerRun;
+    if( !s.runFails ) {
+        msec += qint64(_cost.changeMsec) * changes;
+        requests += changes;
+    }
+    _requests += requests;
+    _busyMsec += qMin( msec, _duration - _now );
+    _runs++;
+    _runsByReason[s.reason]++;
+    if( changes == 0 ) _emptyRuns++;
+
+    post( _now + msec, SyncDone, folder );
+}
+
+void SchedulerSim::slotSyncFinished( int folder )
+{
+    FolderState& s = _folders[folder];
+    SyncResult::Status status = SyncResult::Success;
+
+    if( s.runFails ) {
+        _failedRuns++;
+        status = _now < _outageUntil ? SyncResult::Unavailable : SyncResult::Error;
+        s.lastRunDownloaded = false;
+    } else {
+        for( int i = 0; i < s.coveredLocal; i++ ) {
+            _localLatency.append( _now - s.localChanges.at(i) );
+        }
+        for( int i = 0; i < s.coveredRemote; i++ ) {
+            _remoteLatency.append( _now - s.remoteChanges.at(i) );
+        }
+        s.localChanges.erase( s.localChanges.begin(), s.localChanges.begin() + s.coveredLocal );
+        s.remoteChanges.erase( s.remoteChanges.begin(), s.remoteChanges.begin() + s.coveredRemote );
+        s.lastRunDownloaded = s.coveredRemote > 0;
+    }
+    s.coveredLocal = 0;
+    s.coveredRemote = 0;
+
+    // Folder::slotSyncFinished(), the delayed enabling can not be cancelled
+    post( _now + _policy.reenableDelayMsec, WatcherEnable, folder );
+    s.pollInterval = Folder::nextPollInterval( s.pollInterval, s.pollBase, status );
+    if( _policy.watcherBackoff && status != SyncResult::Success ) {
+        s.eventInterval = Folder::nextEventInterval( &s.errorCount, s.eventInterval );
+    }
+    startPollTimer( folder );
+
+    // FolderMan::slotFolderSyncFinished()
+    _currentFolder = -1;
+    post( _now + _policy.syncGapMsec, ScheduleNext, -1 );
+}
+
+/*
+ * FolderWatcher
+ */
+
+void SchedulerSim::changeDetected( int folder )
+{
+    _folders[folder].eventsPending = true;
+    setProcessTimer( folder );
+}
+
+void SchedulerSim::setProcessTimer( int folder )
+{
+    // QTimer::start() restarts a running timer
+    FolderState& s = _folders[folder];
+    post( _now + s.eventInterval, WatcherTimeout, folder, ++s.processGeneration );
+}
+
+void SchedulerSim::slotProcessTimerTimeout( int folder, int generation )
+{
+    FolderState& s = _folders[folder];
+    if( generation != s.processGeneration || !s.eventsPending ) return;
+    s.eventsPending = false;
+    // folderChanged() -> Folder::slotChanged()
+    evaluateSync( folder, Folder::LocalChange );
+}
+
+void SchedulerSim::setEventsEnabled( int folder )
+{
+    FolderState& s = _folders[folder];
+    s.eventsEnabled = true;
+    if( s.eventsPending ) {
+        setProcessTimer( folder );
+    }
+}
+
+/*
+ * FolderMan
+ */
+
+void SchedulerSim::slotScheduleSync( int folder )
+{
+    if( _currentFolder == folder ) {
+        // the request is dropped, the poll timer is stopped nevertheless
+        _droppedRequests++;
+        return;
+    }
+    const FolderState& s = _folders.at(folder);
+    _scheduler.enqueue( s.alias, s.reason, 1.0, _now );
+    _maxQueueDepth = qMax( _maxQueueDepth, _scheduler.depth() );
+    slotScheduleFolderSync();
+}
+
+void SchedulerSim::slotScheduleFolderSync()
+{
+    if( _currentFolder != -1 || _scheduler.depth() == 0 ) return;
+
+    const QString alias = _scheduler.takeNext( _now );
+    _currentFolder = _folderIndex.value( alias );
+    _queueDelay.append( _scheduler.lastWaitTime() );
+    startSync( _currentFolder );
+}
+
+namespace {
+
+void writePercentiles( QTextStream& out, const char *name, QVector<qint64>& samples, bool last = false )
+{
+    out << "    \"" << name << "\": { \"count\": " << samples.count()
+        << ", \"p50\": " << BenchUtils::percentile( samples, 50 )
+        << ", \"p90\": " << BenchUtils::percentile( samples, 90 )
+        << ", \"p99\": " << BenchUtils::percentile( samples, 99 )
+        << ", \"max\": " << BenchUtils::percentile( samples, 100 ) << " }"
+        << (last ? "\n" : ",\n");
+}
+
+}
+
+void SchedulerSim::writeReport( QTextStream& out )
+{
+    QVector<qint64> pendingAge;
+    foreach( const FolderState& s, _folders ) {
+        foreach( qint64 t, s.localChanges + s.remoteChanges ) {
+            pendingAge.append( _now - t );
+        }
+    }
+    const double hours = _duration / 3600000.0;
+
+    out << "  \"folders\": " << _folders.count() << ",\n";
+    out << "  \"simulatedMsec\": " << _duration << ",\n";
+    out << "  \"events\": " << _processedEvents << ",\n";
+    out << "  \"runs\": { \"total\": " << _runs
+        << ", \"failed\": " << _failedRuns
+        << ", \"withoutChanges\": " << _emptyRuns
+        << ", \"poll\": " << _runsByReason[Folder::Poll]
+        << ", \"remoteChange\": " << _runsByReason[Folder::RemoteChange]
+        << ", \"localChange\": " << _runsByReason[Folder::LocalChange] << " },\n";
+    out << "  \"requests\": { \"total\": " << _requests
+        << ", \"perFolderHour\": " << (hours > 0 ? _requests / hours / _folders.count() : 0.0) << " },\n";
+    out << "  \"utilization\": " << (_duration > 0 ? double(_busyMsec) / _duration : 0.0) << ",\n";
+    out << "  \"maxQueueDepth\": " << _maxQueueDepth << ",\n";
+    out << "  \"droppedRequests\": " << _droppedRequests << ",\n";
+    out << "  \"eventsWhileDisabled\": " << _eventsWhileDisabled << ",\n";
+    out << "  \"msec\": {\n";
+    writePercentiles( out, "queueDelay", _queueDelay );
+    writePercentiles( out, "localChangeToSynced", _localLatency );
+    writePercentiles( out, "remoteChangeToSynced", _remoteLatency );
+    writePercentiles( out, "unsyncedAtEnd", pendingAge, true );
+    out << "  }\n";
+}
+
+}
+
+namespace {
+
+static const char usageC[] =
+        "Usage: schedsim [options]\n"
+        "Replays a change trace for many folders through the scheduling rules\n"
+        "of the client on a virtual clock and reports the queueing delay, the\n"
+        "time from a change until it is synced and the server requests as JSON.\n\n"
+        "Trace:\n"
+        "  --trace <file>           : replay the trace in <file>, lines of\n"
+        "                             \"<msec> <folder> local|remote [<count>]\"\n"
+        "                             or \"<msec> - outage <duration msec>\".\n"
+        "  --folders <n>            : folders of the synthetic trace, default 100.\n"
+        "  --duration <sec>         : simulated time, default 3600.\n"
+        "  --local-rate <n>         : local changes per folder and hour, default 10.\n"
+        "  --remote-rate <n>        : remote changes per folder and hour, default 10.\n"
+        "  --write-trace <file>     : write the synthetic trace to <file>.\n"
+        "Policy:\n"
+        "  --poll-interval <msec>   : remote poll interval, default 30000.\n"
+        "  --no-jitter              : all folders poll with the same interval.\n"
+        "  --gap <msec>             : pause between two runs, default 200.\n"
+        "  --event-interval <msec>  : watcher coalescing interval, default 1000.\n"
+        "  --reenable-delay <msec>  : watcher pause after a run, default 2000.\n"
+        "  --aging-interval <msec>  : aging of the scheduler queue, default 60000.\n"
+        "  --watcher-backoff        : double the watcher interval on errors.\n"
+        "  --no-initial-sync        : do not schedule all folders at the start.\n"
+        "Cost of a run:\n"
+        "  --run-msec <msec>        : a run without changes, default 2000.\n"
+        "  --change-msec <msec>     : on top per changed file, default 200.\n"
+        "  --requests-per-run <n>   : requests of a run without changes, default 1.\n"
+        "  --error-rate <share>     : share of failing runs, default 0.\n"
+        "Other:\n"
+        "  --seed <n>               : seed of the trace and the jitter, default 1.\n"
+        "  --output <file>          : write the JSON to <file> instead of stdout.\n"
+        "  --verbose                : print the log output to stderr.\n"
+        "  -h --help                : show this help screen.\n"
+        ;
+
+bool verbose = false;
+
+void messageHandler( QtMsgType type, const char *msg )
+{
+    if( type == QtDebugMsg && !verbose ) return;
+    fprintf( stderr, "%s\n", msg );
+}
+
+bool readTrace( const QString& fileName, QList<Mirall::SimChange> *trace, int *folders )
+{
+    QFile file( fileName );
+    if( !file.open( QIODevice::ReadOnly | QIODevice::Text ) ) {
+        std::cerr << "Can not read " << qPrintable(fileName) << std::endl;
+        return false;
+    }
+    int lineNo = 0;
+    while( !file.atEnd() ) {
+        const QString line = QString::fromUtf8( file.readLine() ).trimmed();
+        lineNo++;
+        if( line.isEmpty() || line.startsWith( QLatin1Char('#') ) ) continue;
+
+        const QStringList fields = line.split( QLatin1Char(' '), QString::SkipEmptyParts );
+        Mirall::SimChange change;
+        bool ok = fields.count() >= 3;
+        if( ok ) change.msec = fields.at(0).toLongLong( &ok );
+        change.count = 1;
+        change.duration = 0;
+        change.folder = -1;
+        if( ok && fields.at(2) == QLatin1String("outage") ) {
+            change.kind = Mirall::SimChange::Outage;
+            ok = fields.count() == 4;
+            if( ok ) change.duration = fields.at(3).toLongLong( &ok );
+        } else if( ok && (fields.at(2) == QLatin1String("local") || fields.at(2) == QLatin1String("remote")) ) {
+            change.kind = fields.at(2) == QLatin1String("local") ? Mirall::SimChange::Local
+                                                                  : Mirall::SimChange::Remote;
+            change.folder = fields.at(1).toInt( &ok );
+            if( ok && fields.count() > 3 ) change.count = fields.at(3).toInt( &ok );
+            ok = ok && change.folder >= 0 && change.count > 0;
+            if( ok ) *folders = qMax( *folders, change.folder + 1 );
+        } else {
+            ok = false;
+        }
+        if( !ok ) {
+            std::cerr << qPrintable(fileName) << ":" << lineNo << ": invalid line" << std::endl;
+            return false;
+        }
+        trace->append( change );
+    }
+    return true;
+}
+
+/*
+ * Poisson arrivals per folder, local and remote independent.
+ */
+QList<Mirall::SimChange> syntheticTrace( int folders, qint64 durationMsec,
+                                         double localRate, double remoteRate, unsigned seed )
+{
+    QMap<qint64, Mirall::SimChange> sorted;
+    unsigned state = seed ? seed : 1;
+    for( int f = 0; f < folders; f++ ) {
+        for( int k = 0; k < 2; k++ ) {
+            const double rate = k == 0 ? localRate : remoteRate;
+            if( rate <= 0.0 ) continue;
+            const double meanMsec = 3600000.0 / rate;
+            double t = 0.0;
+            forever {
+                state ^= state << 13;
+                state ^= state >> 17;
+                state ^= state << 5;
+                t += -log( 1.0 - state / 4294967296.0 ) * meanMsec;
+                if( t >= durationMsec ) break;
+                Mirall::SimChange change;
+                change.msec = qint64(t);
+                change.folder = f;
+                change.kind = k == 0 ? Mirall::SimChange::Local : Mirall::SimChange::Remote;
+                change.count = 1;
+                change.duration = 0;
+                sorted.insertMulti( change.msec, change );
+            }
+        }
+    }
+    return sorted.values();
+}
+
+bool writeTrace( const QString& fileName, const QList<Mirall::SimChange>& trace )
+{
+    QFile file( fileName );
+    if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text ) ) {
+        std::cerr << "Can not write " << qPrintable(fileName) << std::endl;
+        return false;
+    }
+    QTextStream out( &file );
+    out << "# msec folder local|remote count, or msec - outage duration\n";
+    foreach( const Mirall::SimChange& change, trace ) {
+        if( change.kind == Mirall::SimChange::Outage ) {
+            out << change.msec << " - outage " << change.duration << "\n";
+        } else {
+            out << change.msec << " " << change.folder << " "
+                << (change.kind == Mirall::SimChange::Local ? "local " : "remote ") << change.count << "\n";
+        }
+    }
+    return true;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    qInstallMsgHandler( messageHandler );
+
+    QStringList args = app.arguments();
+    QString traceFile, writeTraceFile, outFile;
+    int folders = 100;
+    qint64 durationMsec = 3600000;
+    double localRate = 10.0;
+    double remoteRate = 10.0;
+    unsigned seed = 1;
+    Mirall::SimPolicy policy;
+    Mirall::SimCost cost;
+
+    for( int i = 1; i < args.count(); i++ ) {
+        const QString option = args.at(i);
+        bool hasValue = i+1 < args.count();
+        bool ok = true;
+
+        if( option == QLatin1String("-h") || option == QLatin1String("--help") ) {
+            std::cout << usageC;
+            return EXIT_SIM_OK;
+        } else if( option == QLatin1String("--trace") && hasValue ) {
+            traceFile = args.at(++i);
+        } else if( option == QLatin1String("--write-trace") && hasValue ) {
+            writeTraceFile = args.at(++i);
+        } else if( option == QLatin1String("--output") && hasValue ) {
+            outFile = args.at(++i);
+        } else if( option == QLatin1String("--folders") && hasValue ) {
+            folders = args.at(++i).toInt( &ok );
+        } else if( option == QLatin1String("--duration") && hasValue ) {
+            durationMsec = 1000 * args.at(++i).toLongLong( &ok );
+        } else if( option == QLatin1String("--local-rate") && hasValue ) {
+            localRate = args.at(++i).toDouble( &ok );
+        } else if( option == QLatin1String("--remote-rate") && hasValue ) {
+            remoteRate = args.at(++i).toDouble( &ok );
+        } else if( option == QLatin1String("--poll-interval") && hasValue ) {
+            policy.pollIntervalMsec = args.at(++i).toInt( &ok );
+        } else if( option == QLatin1String("--no-jitter") ) {
+            policy.pollJitter = false;
+        } else if( option == QLatin1String("--gap") && hasValue ) {
+            policy.syncGapMsec = args.at(++i).toInt( &ok );
+        } else if( option == QLatin1String("--event-interval") && hasValue ) {
+            policy.eventIntervalMsec = args.at(++i).toInt( &ok );
+        } else if( option == QLatin1String("--reenable-delay") && hasValue ) {
+            policy.reenableDelayMsec = args.at(++i).toInt( &ok );
+        } else if( option == QLatin1String("--aging-interval") && hasValue ) {
+            policy.agingIntervalMsec = args.at(++i).toLongLong( &ok );
+        } else if( option == QLatin1String("--watcher-backoff") ) {
+            policy.watcherBackoff = true;
+        } else if( option == QLatin1String("--no-initial-sync") ) {
+            policy.initialSync = false;
+        } else if( option == QLatin1String("--run-msec") && hasValue ) {
+            cost.runMsec = args.at(++i).toInt( &ok );
+        } else if( option == QLatin1String("--change-msec") && hasValue ) {
+            cost.changeMsec = args.at(++i).toInt( &ok );
+        } else if( option == QLatin1String("--requests-per-run") && hasValue ) {
+            cost.requestsPerRun = args.at(++i).toInt( &ok );
+        } else if( option == QLatin1String("--error-rate") && hasValue ) {
+            cost.errorRate = args.at(++i).toDouble( &ok );
+        } else if( option == QLatin1String("--seed") && hasValue ) {
+            seed = args.at(++i).toUInt( &ok );
+        } else if( option == QLatin1String("--verbose") ) {
+            verbose = true;
+        } else {
+            ok = false;
+        }
+        if( !ok ) {
+            std::cerr << usageC;
+            return EXIT_USAGE;
+        }
+    }
+
+    QList<Mirall::SimChange> trace;
+    if( !traceFile.isEmpty() ) {
+        folders = 0;
+        if( !readTrace( traceFile, &trace, &folders ) ) {
+            return EXIT_SIM_ERROR;
+        }
+        qint64 last = 0;
+        foreach( const Mirall::SimChange& change, trace ) {
+            last = qMax( last, change.msec + change.duration );
+        }
+        // the changes at the end need time to be synced
+        durationMsec = qMax( durationMsec, last );
+    } else {
+        trace = syntheticTrace( folders, durationMsec, localRate, remoteRate, seed );
+    }
+    if( folders <= 0 || durationMsec <= 0 || policy.pollIntervalMsec <= 0 ) {
+        std::cerr << usageC;
+        return EXIT_USAGE;
+    }
+    if( !writeTraceFile.isEmpty() && !writeTrace( writeTraceFile, trace ) ) {
+        return EXIT_SIM_ERROR;
+    }
+
+    QTime t;
+    t.start();
+    Mirall::SchedulerSim sim( folders, policy, cost, seed );
+    sim.run( trace, durationMsec );
+    const int wallMsec = t.elapsed();
+
+    QFile file;
+    if( outFile.isEmpty() ) {
+        file.open( stdout, QIODevice::WriteOnly | QIODevice::Text );
+    } else {
+        file.setFileName( outFile );
+        if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text ) ) {
+            std::cerr << "Can not write " << qPrintable(outFile) << std::endl;
+            return EXIT_SIM_ERROR;
+        }
+    }
+
+    QTextStream out( &file );
+    out << "{\n";
+    out << "  \"trace\": " << BenchUtils::jsonString( traceFile.isEmpty() ? QLatin1String("synthetic") : traceFile ) << ",\n";
+    out << "  \"changes\": " << trace.count() << ",\n";
+    out << "  \"wallMsec\": " << wallMsec << ",\n";
+    sim.writeReport( out );
+    out << "}\n";
+    out.flush();
+    return EXIT_SIM_OK;
+}
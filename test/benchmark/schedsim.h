@@ -0,0 +1,177 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#ifndef MIRALL_SCHEDSIM_H
+#define MIRALL_SCHEDSIM_H
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QString>
+#include <QVector>
+#include <QTextStream>
+
+#include "mirall/folder.h"
+#include "mirall/syncscheduler.h"
+
+namespace Mirall {
+
+/**
+ * One line of a change trace: files changed locally or on the server, or
+ * the server is unavailable for a while.
+ */
+struct SimChange {
+    enum Kind {
+        Local = 0,
+        Remote,
+        Outage
+    };
+
+    qint64 msec;
+    int    folder;
+    Kind   kind;
+    int    count;
+    qint64 duration;
+};
+
+/**
+ * The timing rules of Folder, FolderWatcher and FolderMan, the defaults
+ * are the ones of the client.
+ */
+struct SimPolicy {
+    SimPolicy();
+
+    int    pollIntervalMsec;
+    bool   pollJitter;
+    int    syncGapMsec;
+    int    eventIntervalMsec;
+    int    reenableDelayMsec;
+    qint64 agingIntervalMsec;
+    // Folder::incrementErrorCount() after every failed run
+    bool   watcherBackoff;
+    // all folders are scheduled at the start, like the client does
+    bool   initialSync;
+};
+
+/**
+ * What a sync run costs, a stand-in for the server.
+ */
+struct SimCost {
+    SimCost();
+
+    int    runMsec;          // a run without changes
+    int    changeMsec;       // on top per changed file
+    int    requestsPerRun;   // requests of a run without changes
+    double errorRate;        // share of the runs that fail
+};
+
+/**
+ * Replays a change trace on a virtual clock through the scheduling rules
+ * of the client. The folder and the watcher logic is modelled here, the
+ * queue is the SyncScheduler of FolderMan and the intervals come from the
+ * static rules of Folder, so scheduler changes show up unchanged.
+ */
+class SchedulerSim
+{
+public:
+    SchedulerSim( int folders, const SimPolicy&, const SimCost&, unsigned seed );
+
+    void run( const QList<SimChange>& trace, qint64 durationMsec );
+
+    void writeReport( QTextStream& );
+
+private:
+    enum EventType {
+        TraceEvent = 0,
+        PollTimeout,
+        WatcherTimeout,
+        WatcherEnable,
+        SyncDone,
+        ScheduleNext
+    };
+
+    struct Event {
+        EventType type;
+        int       folder;
+        int       generation;
+        int       traceIndex;
+    };
+
+    struct FolderState {
+        QString            alias;
+        int                pollBase;
+        int                pollInterval;
+        int                pollGeneration;
+        int                eventInterval;
+        bool               eventsEnabled;
+        bool               eventsPending;
+        int                processGeneration;
+        int                errorCount;
+        bool               lastRunDownloaded;
+        Folder::SyncReason reason;
+        // times of the changes no successful run covered yet, oldest first
+        QList<qint64>      localChanges;
+        QList<qint64>      remoteChanges;
+        // changes the current run covers
+        int                coveredLocal;
+        int                coveredRemote;
+        bool               runFails;
+    };
+
+    void post( qint64 at, EventType type, int folder, int generation = 0, int traceIndex = -1 );
+    double random();
+
+    // Folder
+    void evaluateSync( int folder, Folder::SyncReason reason );
+    void startPollTimer( int folder );
+    void slotPollTimerTimeout( int folder );
+    void startSync( int folder );
+    void slotSyncFinished( int folder );
+    // FolderWatcher
+    void changeDetected( int folder );
+    void setProcessTimer( int folder );
+    void slotProcessTimerTimeout( int folder, int generation );
+    void setEventsEnabled( int folder );
+    // FolderMan
+    void slotScheduleSync( int folder );
+    void slotScheduleFolderSync();
+
+    void applyTrace( const SimChange& );
+
+    SimPolicy             _policy;
+    SimCost               _cost;
+    unsigned              _random;
+    QVector<FolderState>  _folders;
+    QHash<QString, int>   _folderIndex;
+    SyncScheduler         _scheduler;
+    int                   _currentFolder;
+    qint64                _now;
+    qint64                _duration;
+    qint64                _outageUntil;
+    quint64               _sequence;
+    QMap<QPair<qint64, quint64>, Event> _events;
+    QList<SimChange>      _trace;
+
+    // results
+    QVector<qint64> _queueDelay;
+    QVector<qint64> _localLatency;
+    QVector<qint64> _remoteLatency;
+    qint64 _processedEvents;
+    int    _runs;
+    int    _failedRuns;
+    int    _emptyRuns;
+    int    _runsByReason[3];
+    int    _droppedRequests;
+    qint64 _eventsWhileDisabled;
+    qint64 _requests;
+    qint64 _busyMsec;
+    int    _maxQueueDepth;
+};
+
+}
+
+#endif
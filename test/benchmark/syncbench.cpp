@@ -0,0 +1,408 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#include <iostream>
+#include <stdio.h>
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QTextStream>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QFile>
+#include <QDir>
+#include <QDirIterator>
+#include <QTime>
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+#include <sys/utime.h>
+#else
+#include <utime.h>
+#endif
+
+#include <csync.h>
+
+#include "benchutils.h"
+#include "davserver.h"
+#include "torturelayout.h"
+#include "mirall/csyncthread.h"
+
+/* exit codes of the benchmark */
+#define EXIT_BENCH_OK     0
+#define EXIT_BENCH_ERROR  1
+#define EXIT_USAGE        2
+
+/* every n-th file of the layout is changed in the small change scenario */
+#define SMALL_CHANGE_STRIDE 100
+/* number and size of the files the small change scenario adds */
+#define SMALL_CHANGE_NEW_FILES 10
+#define SMALL_CHANGE_NEW_SIZE  4096
+
+namespace {
+
+static const char usageC[] =
+        "Usage: syncbench [options] <layout.lay>\n"
+        "Creates the tree of the torture layout, syncs it with a local WebDAV\n"
+        "stand-in server in several scenarios and prints the timings as JSON.\n\n"
+        "Options:\n"
+        "  -h --help            : show this help screen.\n"
+        "  --output <file>      : write the JSON to <file> instead of stdout.\n"
+        "  --workdir <dir>      : directory for the trees, default is a new\n"
+        "                         directory in the temp dir.\n"
+        "  --shrink <n>         : divide all file sizes of the layout by n.\n"
+        "  --chunk-size <bytes> : upload files in chunks of this size, to run\n"
+        "                         the chunked upload path with small layouts.\n"
+        "  --chunk-threshold <bytes> : upload files larger than this in chunks,\n"
+        "                         default is the chunk size.\n"
+        "  --keep               : do not remove the work directory.\n"
+        "  --verbose            : print the log output to stderr.\n"
+        ;
+
+bool verbose = false;
+// 0 keeps the defaults of the owncloud module
+qint64 chunkSize = 0;
+qint64 chunkThreshold = 0;
+
+void messageHandler( QtMsgType type, const char *msg )
+{
+    if( type == QtDebugMsg && !verbose ) return;
+    fprintf( stderr, "%s\n", msg );
+}
+
+void csyncLogCatcher( CSYNC *ctx, int verbosity, const char *function,
+                      const char *buffer, void *userdata )
+{
+    Q_UNUSED(ctx); Q_UNUSED(verbosity); Q_UNUSED(function); Q_UNUSED(userdata);
+    if( verbose ) {
+        fprintf( stderr, "%s\n", buffer );
+    }
+}
+
+struct ScenarioResult {
+    QString            name;
+    int                wallMsec;
+    Mirall::SyncResult result;
+    DavServer::Stats   server;
+};
+
+void writeScenario( QTextStream& out, const ScenarioResult& s )
+{
+    const Mirall::SyncResult& r = s.result;
+    out << "    {\n";
+    out << "      \"name\": " << BenchUtils::jsonString( s.name ) << ",\n";
+    out << "      \"status\": " << BenchUtils::jsonString( r.statusString() ) << ",\n";
+    out << "      \"wallMsec\": " << s.wallMsec << ",\n";
+
+    out << "      \"phases\": {";
+    QHash<QString, int> phases = r.phaseTimes();
+    QStringList names = phases.keys();
+    for( int i = 0; i < names.count(); i++ ) {
+        out << (i ? ", " : " ") << BenchUtils::jsonString( names.at(i) ) << ": " << phases.value( names.at(i) );
+    }
+    out << " },\n";
+
+    out << "      \"items\": " << r.syncFileItemVector().count() << ",\n";
+    out << "      \"transferredFiles\": " << r.transferredFiles() << ",\n";
+    out << "      \"uploadedBytes\": " << r.uploadedBytes() << ",\n";
+    out << "      \"downloadedBytes\": " << r.downloadedBytes() << ",\n";
+
+    out << "      \"requests\": " << s.server.requests << ",\n";
+    out << "      \"methods\": {";
+    QMap<QString, int>::const_iterator it = s.server.methods.constBegin();
+    for( ; it != s.server.methods.constEnd(); ++it ) {
+        out << (it == s.server.methods.constBegin() ? " " : ", ")
+            << BenchUtils::jsonString( it.key() ) << ": " << it.value();
+    }
+    out << " },\n";
+    out << "      \"serverBytesReceived\": " << s.server.bytesReceived << ",\n";
+    out << "      \"serverBytesSent\": " << s.server.bytesSent << ",\n";
+    out << "      \"chunks\": " << s.server.chunks << ",\n";
+    out << "      \"chunkedFiles\": " << s.server.chunkedFiles << ",\n";
+
+    out << "      \"errors\": [";
+    QStringList errors = r.errorStrings();
+    for( int i = 0; i < errors.count(); i++ ) {
+        out << (i ? ", " : " ") << BenchUtils::jsonString( errors.at(i) );
+    }
+    out << " ]\n";
+    out << "    }";
+}
+
+void setMTime( const QString& fileName, uint secs )
+{
+    struct utimbuf times;
+    times.actime  = secs;
+    times.modtime = secs;
+    utime( QFile::encodeName(fileName).constData(), &times );
+}
+
+/*
+ * one sync run of localDir with the server, the calling thread blocks
+ * until it is done.
+ */
+ScenarioResult runSync( const QString& name, const QString& localDir, const QString& remote,
+                        const QString& confDir, DavServerThread *server )
+{
+    ScenarioResult s;
+    s.name = name;
+    server->resetStats();
+
+    QTime t;
+    t.start();
+
+    CSYNC *ctx = 0;
+    if( csync_create( &ctx, localDir.toUtf8().data(), remote.toUtf8().data() ) < 0 ) {
+        s.result.setErrorString( QLatin1String("Unable to create csync-context") );
+        s.result.setStatus( Mirall::SyncResult::SetupError );
+    } else {
+        csync_set_log_callback( ctx, csyncLogCatcher );
+        csync_set_log_verbosity( ctx, verbose ? 11 : 0 );
+        csync_set_config_dir( ctx, confDir.toUtf8() );
+        csync_enable_conflictcopys( ctx );
+
+        if( csync_init( ctx ) < 0 ) {
+            s.result.setErrorString( Mirall::CSyncThread::csyncErrorToString( csync_get_error(ctx),
+                                                                              csync_get_error_string(ctx) ) );
+            s.result.setStatus( Mirall::SyncResult::SetupError );
+        } else {
+            if( chunkSize > 0 || chunkThreshold > 0 ) {
+                int64_t blockSize = chunkSize;
+                int64_t threshold = chunkThreshold > 0 ? chunkThreshold : chunkSize;
+                if( blockSize > 0 && csync_set_module_property( ctx, "hbf_block_size", &blockSize ) < 0 ) {
+                    qWarning() << "The owncloud module does not know hbf_block_size";
+                }
+                if( threshold > 0 && csync_set_module_property( ctx, "hbf_threshold", &threshold ) < 0 ) {
+                    qWarning() << "The owncloud module does not know hbf_threshold";
+                }
+            }
+
+            Mirall::CSyncThread csyncThread( ctx );
+            csyncThread.setLocalPath( localDir );
+
+            Mirall::BenchSyncObserver observer;
+            QObject::connect( &csyncThread, SIGNAL(csyncError(QString)),
+                              &observer, SLOT(slotCSyncError(QString)) );
+            QObject::connect( &csyncThread, SIGNAL(phaseTime(QString,int)),
+                              &observer, SLOT(slotPhaseTime(QString,int)) );
+            QObject::connect( &csyncThread, SIGNAL(transferProgress(int,qint64,qint64)),
+                              &observer, SLOT(slotTransferProgress(int,qint64,qint64)) );
+            QObject::connect( &csyncThread, SIGNAL(treeWalkResult(SyncFileItemVector)),
+                              &observer, SLOT(slotTreeWalkResult(SyncFileItemVector)) );
+            QObject::connect( &csyncThread, SIGNAL(aboutToRemoveAllFiles(SyncFileItem::Direction,bool*)),
+                              &observer, SLOT(slotAboutToRemoveAllFiles(SyncFileItem::Direction,bool*)) );
+
+            csyncThread.startSync();
+            s.result = observer.result();
+            s.result.setStatus( s.result.errorStrings().isEmpty() ? Mirall::SyncResult::Success
+                                                                  : Mirall::SyncResult::Error );
+        }
+        csync_destroy( ctx );
+    }
+
+    s.wallMsec = t.elapsed();
+    s.server = server->stats();
+    qDebug() << "Scenario" << name << "took" << s.wallMsec << "msec," << s.server.requests << "requests";
+    return s;
+}
+
+// rewrites every n-th file with other content and adds a few new files.
+void makeSmallChange( const TortureLayout& layout, const QString& localDir )
+{
+    const QList<TortureLayout::Entry>& entries = layout.entries();
+    for( int i = 0; i < entries.count(); i += SMALL_CHANGE_STRIDE ) {
+        const TortureLayout::Entry& e = entries.at(i);
+        const QString fileName = localDir + QLatin1Char('/') + e.path;
+        uint mtime = QFileInfo( fileName ).lastModified().toTime_t();
+        TortureLayout::writeFile( fileName, e.path, e.size, 1 );
+        // the sync compares seconds, make sure the change is seen.
+        setMTime( fileName, mtime + 2 );
+    }
+    for( int i = 0; i < SMALL_CHANGE_NEW_FILES; i++ ) {
+        const QString path = QString::fromLatin1("bench-new/newfile-%1.txt").arg(i);
+        TortureLayout::writeFile( localDir + QLatin1Char('/') + path, path, SMALL_CHANGE_NEW_SIZE, 1 );
+    }
+}
+
+// files of the tree below a that are missing below b or differ in content.
+QStringList compareTrees( const QString& a, const QString& b )
+{
+    QStringList differences;
+    QDirIterator it( a, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories );
+    while( it.hasNext() ) {
+        it.next();
+        if( it.fileName().startsWith( QLatin1String(".csync") ) ) continue;
+        const QString rel = it.filePath().mid( a.length() + 1 );
+
+        QFile fa( it.filePath() );
+        QFile fb( b + QLatin1Char('/') + rel );
+        if( !fb.open( QIODevice::ReadOnly ) || !fa.open( QIODevice::ReadOnly )
+                || fa.size() != fb.size() ) {
+            differences.append( rel );
+            continue;
+        }
+        while( !fa.atEnd() ) {
+            if( fa.read( 1024*1024 ) != fb.read( 1024*1024 ) ) {
+                differences.append( rel );
+                break;
+            }
+        }
+    }
+    return differences;
+}
+
+// removes every second entry of the top level, at least one is kept.
+void makeLargeDelete( const QString& localDir )
+{
+    QDir dir( localDir );
+    QFileInfoList top = dir.entryInfoList( QDir::AllEntries | QDir::NoDotAndDotDot, QDir::Name );
+    for( int i = 0; i < top.count(); i += 2 ) {
+        if( top.at(i).fileName().startsWith( QLatin1String(".csync") ) ) continue;
+        BenchUtils::removeTree( top.at(i).absoluteFilePath() );
+    }
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    qInstallMsgHandler( messageHandler );
+
+    QStringList args = app.arguments();
+    QString layFile, outFile, workDir;
+    int shrink = 1;
+    bool keep = false;
+
+    for( int i = 1; i < args.count(); i++ ) {
+        const QString option = args.at(i);
+        bool hasValue = i+1 < args.count();
+
+        if( option == QLatin1String("-h") || option == QLatin1String("--help") ) {
+            std::cout << usageC;
+            return EXIT_BENCH_OK;
+        } else if( option == QLatin1String("--output") && hasValue ) {
+            outFile = args.at(++i);
+        } else if( option == QLatin1String("--workdir") && hasValue ) {
+            workDir = args.at(++i);
+        } else if( option == QLatin1String("--shrink") && hasValue ) {
+            shrink = args.at(++i).toInt();
+        } else if( option == QLatin1String("--chunk-size") && hasValue ) {
+            chunkSize = args.at(++i).toLongLong();
+        } else if( option == QLatin1String("--chunk-threshold") && hasValue ) {
+            chunkThreshold = args.at(++i).toLongLong();
+        } else if( option == QLatin1String("--keep") ) {
+            keep = true;
+        } else if( option == QLatin1String("--verbose") ) {
+            verbose = true;
+        } else if( option.startsWith( QLatin1String("--") ) || !layFile.isEmpty() ) {
+            std::cerr << usageC;
+            return EXIT_USAGE;
+        } else {
+            layFile = option;
+        }
+    }
+    if( layFile.isEmpty() ) {
+        std::cerr << usageC;
+        return EXIT_USAGE;
+    }
+
+    TortureLayout layout;
+    if( !layout.load( layFile ) ) {
+        return EXIT_BENCH_ERROR;
+    }
+    layout.shrink( shrink );
+
+    if( workDir.isEmpty() ) {
+        workDir = QDir::tempPath() + QString::fromLatin1("/syncbench-%1").arg( app.applicationPid() );
+    }
+    const QString localDir    = workDir + QLatin1String("/local");
+    const QString downloadDir = workDir + QLatin1String("/download");
+    const QString remoteDir   = workDir + QLatin1String("/remote");
+    const QString confDir     = workDir + QLatin1String("/conf");
+    foreach( const QString& dir, QStringList() << localDir << downloadDir << remoteDir << confDir ) {
+        if( QFileInfo( dir ).exists() ) {
+            std::cerr << "The work directory is not empty: " << qPrintable(workDir) << std::endl;
+            return EXIT_USAGE;
+        }
+        QDir().mkpath( dir );
+    }
+
+    QTime t;
+    t.start();
+    if( !layout.create( localDir ) ) {
+        return EXIT_BENCH_ERROR;
+    }
+    int createMsec = t.elapsed();
+    qDebug() << "Created" << layout.fileCount() << "files in" << createMsec << "msec";
+
+    DavServerThread server( remoteDir );
+    quint16 port = server.startServer();
+    if( port == 0 ) {
+        return EXIT_BENCH_ERROR;
+    }
+    const QString remote = QString::fromLatin1("owncloud://127.0.0.1:%1%2/")
+            .arg( port ).arg( DavServer::davPrefix() );
+
+    QList<ScenarioResult> results;
+    results << runSync( QLatin1String("initial-upload"), localDir, remote, confDir, &server );
+    results << runSync( QLatin1String("noop"), localDir, remote, confDir, &server );
+    makeSmallChange( layout, localDir );
+    results << runSync( QLatin1String("small-change"), localDir, remote, confDir, &server );
+    results << runSync( QLatin1String("initial-download"), downloadDir, remote, confDir, &server );
+    // what went up, possibly in chunks, has to come down unchanged.
+    QStringList differences = compareTrees( localDir, downloadDir );
+    foreach( const QString& rel, differences ) {
+        qWarning() << "Downloaded file differs from the upload:" << rel;
+    }
+    makeLargeDelete( localDir );
+    results << runSync( QLatin1String("large-delete"), localDir, remote, confDir, &server );
+
+    server.stopServer();
+
+    QFile file;
+    if( outFile.isEmpty() ) {
+        file.open( stdout, QIODevice::WriteOnly | QIODevice::Text );
+    } else {
+        file.setFileName( outFile );
+        if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text ) ) {
+            std::cerr << "Can not write " << qPrintable(outFile) << std::endl;
+            return EXIT_BENCH_ERROR;
+        }
+    }
+
+    int exitCode = EXIT_BENCH_OK;
+    QTextStream out( &file );
+    out << "{\n";
+    out << "  \"layout\": " << BenchUtils::jsonString( QFileInfo(layFile).fileName() ) << ",\n";
+    out << "  \"files\": " << layout.fileCount() << ",\n";
+    out << "  \"bytes\": " << layout.totalSize() << ",\n";
+    out << "  \"shrink\": " << qMax( 1, shrink ) << ",\n";
+    out << "  \"createMsec\": " << createMsec << ",\n";
+    out << "  \"chunkSize\": " << chunkSize << ",\n";
+    out << "  \"chunkThreshold\": " << chunkThreshold << ",\n";
+    out << "  \"downloadDifferences\": " << differences.count() << ",\n";
+    out << "  \"scenarios\": [\n";
+    for( int i = 0; i < results.count(); i++ ) {
+        writeScenario( out, results.at(i) );
+        out << (i+1 < results.count() ? ",\n" : "\n");
+        if( results.at(i).result.status() != Mirall::SyncResult::Success ) {
+            exitCode = EXIT_BENCH_ERROR;
+        }
+    }
+    out << "  ]\n";
+    out << "}\n";
+    out.flush();
+
+    if( !differences.isEmpty() ) {
+        exitCode = EXIT_BENCH_ERROR;
+    }
+
+    if( !keep ) {
+        BenchUtils::removeTree( workDir );
+    }
+    return exitCode;
+}
@@ -0,0 +1,288 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#include "torturelayout.h"
+
+#include <string.h>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QDirIterator>
+#include <QtConcurrentMap>
+#include <QDebug>
+
+/* bytes generated and written at once */
+#define WRITE_BLOCK_SIZE (64*1024)
+
+namespace {
+
+// xorshift generator, the stream only depends on the path and the seed.
+class ContentGenerator
+{
+public:
+    ContentGenerator( const QString& path, unsigned seed )
+        : _state( qHash(path) ^ (seed * 2654435761u) )
+    {
+        if( _state == 0 ) _state = 0x9e3779b9u;
+    }
+
+    void fill( char *buf, int len )
+    {
+        for( int i = 0; i < len; i++ ) {
+            _state ^= _state << 13;
+            _state ^= _state >> 17;
+            _state ^= _state << 5;
+            buf[i] = char( _state & 0xff );
+        }
+    }
+
+private:
+    quint32 _state;
+};
+
+bool writeContent( const QString& fileName, const QString& path, qint64 size, unsigned seed )
+{
+    QFile file( fileName );
+    if( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+        qWarning() << "Can not write" << fileName;
+        return false;
+    }
+
+    ContentGenerator gen( path, seed );
+    char buf[WRITE_BLOCK_SIZE];
+    qint64 left = size;
+    while( left > 0 ) {
+        int len = int( qMin( left, qint64(WRITE_BLOCK_SIZE) ) );
+        gen.fill( buf, len );
+        if( file.write( buf, len ) != len ) {
+            qWarning() << "Can not write" << fileName;
+            return false;
+        }
+        left -= len;
+    }
+    return true;
+}
+
+// one file for the thread pool, create and validate share it.
+struct FileJob {
+    QString  fileName;
+    QString  path;
+    qint64   size;
+    unsigned seed;
+    bool     checkContent;
+    TortureLayout::FileState state;
+};
+
+void createJob( FileJob& job )
+{
+    if( !writeContent( job.fileName, job.path, job.size, job.seed ) ) {
+        job.state = TortureLayout::FileMissing;
+    }
+}
+
+void validateJob( FileJob& job )
+{
+    job.state = TortureLayout::checkFile( job.fileName, job.path, job.size,
+                                          job.seed, job.checkContent );
+}
+
+QVector<FileJob> fileJobs( const QList<TortureLayout::Entry>& entries, const QString& root,
+                           unsigned seed, bool checkContent )
+{
+    QVector<FileJob> jobs;
+    jobs.reserve( entries.count() );
+    foreach( const TortureLayout::Entry& e, entries ) {
+        FileJob job;
+        job.fileName     = root + QLatin1Char('/') + e.path;
+        job.path         = e.path;
+        job.size         = e.size;
+        job.seed         = seed;
+        job.checkContent = checkContent;
+        job.state        = TortureLayout::FileOk;
+        jobs.append( job );
+    }
+    return jobs;
+}
+
+}
+
+TortureLayout::TortureLayout()
+    : _totalSize(0)
+{
+}
+
+bool TortureLayout::load( const QString& layFile )
+{
+    QFile file( layFile );
+    if( !file.open( QIODevice::ReadOnly | QIODevice::Text ) ) {
+        qWarning() << "Can not open layout" << layFile;
+        return false;
+    }
+
+    _entries.clear();
+    _totalSize = 0;
+    while( !file.atEnd() ) {
+        QString line = QString::fromUtf8( file.readLine() ).trimmed();
+        int colon = line.lastIndexOf( QLatin1Char(':') );
+        if( colon < 1 ) continue;
+
+        Entry e;
+        e.path = QDir::cleanPath( line.left(colon) );
+        if( e.path.startsWith( QLatin1String("./") ) ) e.path.remove( 0, 2 );
+        bool ok;
+        e.size = line.mid( colon+1 ).toLongLong( &ok );
+        if( !ok || e.path.isEmpty() ) {
+            qWarning() << "Bad layout line:" << line;
+            continue;
+        }
+        _entries.append( e );
+        _totalSize += e.size;
+    }
+    return true;
+}
+
+void TortureLayout::shrink( int divisor )
+{
+    if( divisor <= 1 ) return;
+    _totalSize = 0;
+    for( int i = 0; i < _entries.count(); i++ ) {
+        _entries[i].size /= divisor;
+        _totalSize += _entries[i].size;
+    }
+}
+
+const QList<TortureLayout::Entry>& TortureLayout::entries() const
+{
+    return _entries;
+}
+
+int TortureLayout::fileCount() const
+{
+    return _entries.count();
+}
+
+qint64 TortureLayout::totalSize() const
+{
+    return _totalSize;
+}
+
+bool TortureLayout::create( const QString& root, unsigned seed ) const
+{
+    // the directories first, the writers must not race on mkpath.
+    QSet<QString> dirs;
+    foreach( const Entry& e, _entries ) {
+        int slash = e.path.lastIndexOf( QLatin1Char('/') );
+        if( slash > 0 ) dirs.insert( e.path.left(slash) );
+    }
+    foreach( const QString& dir, dirs ) {
+        if( !QDir().mkpath( root + QLatin1Char('/') + dir ) ) {
+            qWarning() << "Can not create" << dir;
+            return false;
+        }
+    }
+
+    QVector<FileJob> jobs = fileJobs( _entries, root, seed, false );
+    QtConcurrent::blockingMap( jobs, createJob );
+
+    foreach( const FileJob& job, jobs ) {
+        if( job.state != FileOk ) return false;
+    }
+    return true;
+}
+
+QList<TortureLayout::Problem> TortureLayout::validate( const QString& root, unsigned seed,
+                                                       bool checkContent ) const
+{
+    QVector<FileJob> jobs = fileJobs( _entries, root, seed, checkContent );
+    QtConcurrent::blockingMap( jobs, validateJob );
+
+    QList<Problem> problems;
+    foreach( const FileJob& job, jobs ) {
+        if( job.state != FileOk ) {
+            Problem p;
+            p.path  = job.path;
+            p.state = job.state;
+            problems.append( p );
+        }
+    }
+    return problems;
+}
+
+QStringList TortureLayout::extraFiles( const QString& root ) const
+{
+    QSet<QString> known;
+    foreach( const Entry& e, _entries ) {
+        known.insert( e.path );
+    }
+
+    QStringList extra;
+    const QString absRoot = QDir( root ).absolutePath();
+    QDirIterator it( absRoot, QDir::Files | QDir::Hidden | QDir::System, QDirIterator::Subdirectories );
+    while( it.hasNext() ) {
+        const QString path = it.next().mid( absRoot.length()+1 );
+        if( it.fileName().startsWith( QLatin1String(".csync_journal") ) ) continue;
+        if( !known.contains( path ) ) {
+            extra.append( path );
+        }
+    }
+    return extra;
+}
+
+bool TortureLayout::writeFile( const QString& fileName, const QString& path,
+                               qint64 size, unsigned seed )
+{
+    QDir().mkpath( QFileInfo(fileName).absolutePath() );
+    return writeContent( fileName, path, size, seed );
+}
+
+TortureLayout::FileState TortureLayout::checkFile( const QString& fileName, const QString& path,
+                                                   qint64 size, unsigned seed, bool checkContent )
+{
+    QFile file( fileName );
+    if( !file.exists() ) return FileMissing;
+    if( file.size() != size ) return FileWrongSize;
+    if( !checkContent ) return FileOk;
+
+    if( !file.open( QIODevice::ReadOnly ) ) return FileMissing;
+
+    // compare against the regenerated stream, nothing is kept in memory.
+    ContentGenerator gen( path, seed );
+    char expected[WRITE_BLOCK_SIZE];
+    char actual[WRITE_BLOCK_SIZE];
+    qint64 left = size;
+    while( left > 0 ) {
+        int len = int( qMin( left, qint64(WRITE_BLOCK_SIZE) ) );
+        gen.fill( expected, len );
+        if( file.read( actual, len ) != len || memcmp( expected, actual, len ) != 0 ) {
+            return FileWrongContent;
+        }
+        left -= len;
+    }
+    return FileOk;
+}
+
+QString TortureLayout::stateName( FileState state )
+{
+    switch( state ) {
+    case FileOk:           return QLatin1String("ok");
+    case FileMissing:      return QLatin1String("missing");
+    case FileWrongSize:    return QLatin1String("wrong size");
+    case FileWrongContent: return QLatin1String("wrong content");
+    }
+    return QString::null;
+}
+
+QByteArray TortureLayout::content( const QString& path, qint64 size, unsigned seed )
+{
+    QByteArray data( int(size), 0 );
+    ContentGenerator gen( path, seed );
+    gen.fill( data.data(), data.size() );
+    return data;
+}
@@ -0,0 +1,92 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#ifndef MIRALL_TORTURELAYOUT_H
+#define MIRALL_TORTURELAYOUT_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QByteArray>
+
+/**
+ * A file tree as described by a .lay file of test/scripts: one
+ * "path:size" line per file, directories are implied by the paths.
+ *
+ * The content of every file is derived from its path and a seed, so a
+ * tree can be created again or checked without keeping the data around.
+ */
+class TortureLayout
+{
+public:
+    struct Entry {
+        QString path;
+        qint64  size;
+    };
+
+    enum FileState {
+        FileOk = 0,
+        FileMissing,
+        FileWrongSize,
+        FileWrongContent
+    };
+
+    struct Problem {
+        QString   path;
+        FileState state;
+    };
+
+    TortureLayout();
+
+    bool load( const QString& layFile );
+
+    // divides all file sizes, to get a smaller data set from a big layout
+    void shrink( int divisor );
+
+    const QList<Entry>& entries() const;
+    int fileCount() const;
+    qint64 totalSize() const;
+
+    /**
+     * writes all files below root, false if any file failed. The files
+     * are written in parallel on the global thread pool.
+     */
+    bool create( const QString& root, unsigned seed = 0 ) const;
+
+    /**
+     * checks the files below root for existence, size and, unless
+     * checkContent is false, content. Runs on the global thread pool.
+     */
+    QList<Problem> validate( const QString& root, unsigned seed = 0,
+                             bool checkContent = true ) const;
+
+    /**
+     * files below root that are not in the layout, the csync journal
+     * is ignored.
+     */
+    QStringList extraFiles( const QString& root ) const;
+
+    /**
+     * writes one file with the content for the given path and seed.
+     */
+    static bool writeFile( const QString& fileName, const QString& path,
+                           qint64 size, unsigned seed );
+
+    static FileState checkFile( const QString& fileName, const QString& path,
+                                qint64 size, unsigned seed, bool checkContent );
+    static QString stateName( FileState );
+
+    /**
+     * the first size bytes of the content of the given path.
+     */
+    static QByteArray content( const QString& path, qint64 size, unsigned seed );
+
+private:
+    QList<Entry> _entries;
+    qint64       _totalSize;
+};
+
+#endif
@@ -0,0 +1,121 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#include <iostream>
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTime>
+
+#include "torturelayout.h"
+
+/* exit codes of the torture tool */
+#define EXIT_TORTURE_OK     0
+#define EXIT_TORTURE_FAILED 1
+#define EXIT_USAGE          2
+
+namespace {
+
+static const char usageC[] =
+        "Usage: torturetool create [options] <layout.lay> <dir>\n"
+        "       torturetool validate [options] <layout.lay> <dir>\n"
+        "create writes the tree of the layout below <dir>, validate checks\n"
+        "a tree, for example a synced one, against the layout.\n\n"
+        "Options:\n"
+        "  -h --help            : show this help screen.\n"
+        "  --threads <n>        : number of threads, default is one per core.\n"
+        "  --seed <n>           : seed of the file content, default 0.\n"
+        "  --shrink <n>         : divide all file sizes of the layout by n.\n"
+        "  --size-only          : validate: check existence and size only.\n"
+        "  --strict             : validate: files not in the layout fail too.\n"
+        ;
+
+}
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+
+    QStringList args = app.arguments();
+    QStringList positional;
+    int threads = 0;
+    unsigned seed = 0;
+    int shrink = 1;
+    bool sizeOnly = false;
+    bool strict = false;
+
+    for( int i = 1; i < args.count(); i++ ) {
+        const QString option = args.at(i);
+        bool hasValue = i+1 < args.count();
+
+        if( option == QLatin1String("-h") || option == QLatin1String("--help") ) {
+            std::cout << usageC;
+            return EXIT_TORTURE_OK;
+        } else if( option == QLatin1String("--threads") && hasValue ) {
+            threads = args.at(++i).toInt();
+        } else if( option == QLatin1String("--seed") && hasValue ) {
+            seed = args.at(++i).toUInt();
+        } else if( option == QLatin1String("--shrink") && hasValue ) {
+            shrink = args.at(++i).toInt();
+        } else if( option == QLatin1String("--size-only") ) {
+            sizeOnly = true;
+        } else if( option == QLatin1String("--strict") ) {
+            strict = true;
+        } else if( option.startsWith( QLatin1String("--") ) ) {
+            std::cerr << usageC;
+            return EXIT_USAGE;
+        } else {
+            positional.append( option );
+        }
+    }
+
+    if( positional.count() != 3 ||
+            (positional.at(0) != QLatin1String("create") && positional.at(0) != QLatin1String("validate")) ) {
+        std::cerr << usageC;
+        return EXIT_USAGE;
+    }
+    const bool create = positional.at(0) == QLatin1String("create");
+    const QString root = positional.at(2);
+
+    if( threads > 0 ) {
+        QThreadPool::globalInstance()->setMaxThreadCount( threads );
+    }
+
+    TortureLayout layout;
+    if( !layout.load( positional.at(1) ) ) {
+        return EXIT_TORTURE_FAILED;
+    }
+    layout.shrink( shrink );
+
+    QTime t;
+    t.start();
+
+    if( create ) {
+        bool ok = layout.create( root, seed );
+        std::cout << "Created " << layout.fileCount() << " files, " << layout.totalSize()
+                  << " bytes in " << t.elapsed() << " msec using "
+                  << QThreadPool::globalInstance()->maxThreadCount() << " threads." << std::endl;
+        return ok ? EXIT_TORTURE_OK : EXIT_TORTURE_FAILED;
+    }
+
+    QList<TortureLayout::Problem> problems = layout.validate( root, seed, !sizeOnly );
+    foreach( const TortureLayout::Problem& p, problems ) {
+        std::cout << qPrintable( TortureLayout::stateName(p.state) ) << ": "
+                  << qPrintable( p.path ) << std::endl;
+    }
+    QStringList extra = layout.extraFiles( root );
+    foreach( const QString& path, extra ) {
+        std::cout << "extra: " << qPrintable( path ) << std::endl;
+    }
+
+    std::cout << "Checked " << layout.fileCount() << " files in " << t.elapsed() << " msec using "
+              << QThreadPool::globalInstance()->maxThreadCount() << " threads: "
+              << problems.count() << " problems, " << extra.count() << " extra files." << std::endl;
+
+    bool ok = problems.isEmpty() && (!strict || extra.isEmpty());
+    return ok ? EXIT_TORTURE_OK : EXIT_TORTURE_FAILED;
+}
@@ -0,0 +1,745 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#include "config.h"
+
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+#include <QThread>
+#include <QDebug>
+
+#include <csync.h>
+
+#include "fakecsync.h"
+
+/* the longest sleep between two checks for an abort request */
+#define MAX_SLEEP_USEC 50000
+
+/* modification time of all synthesised files */
+#define FAKE_MTIME 1356998400
+
+namespace FakeCSync {
+
+// what happened to a file since the last sync
+enum Change {
+    InSync = 0,
+    NewLocal,
+    NewRemote,
+    ChangedLocal,
+    ChangedRemote,
+    RemovedLocal,
+    RemovedRemote,
+    Renamed,
+    Conflict
+};
+
+enum State {
+    Created = 0,
+    Initialized,
+    Updated,
+    Reconciled,
+    Propagated
+};
+
+}
+
+using namespace FakeCSync;
+
+/*
+ * The context of the double. csync.h only has the forward declaration,
+ * the real library and the double each define it on their own.
+ */
+struct csync_s {
+    QByteArray              local;
+    QByteArray              remote;
+    QByteArray              configDir;
+    Config                  config;
+    int                     number;
+    State                   state;
+    int                     runs;
+    unsigned                runSeed;
+    void                   *userdata;
+    csync_auth_callback     authCallback;
+    csync_log_callback      logCallback;
+    csync_progress_callback progressCallback;
+    int                     logVerbosity;
+    QAtomicInt              abort;
+    CSYNC_ERROR_CODE        error;
+    QByteArray              errorString;
+    qint64                  sleepDebt;
+};
+
+namespace {
+
+QMutex mutex;
+bool   configRead = false;
+Config globalConfig;
+Stats  globalStats;
+
+// QThread::usleep is protected in Qt 4
+class Sleeper : public QThread
+{
+public:
+    static void sleepUsec( unsigned long usec ) { QThread::usleep( usec ); }
+};
+
+// call with the mutex locked
+void readEnvironment()
+{
+    if( configRead ) return;
+    configRead = true;
+    const QString env = QString::fromLocal8Bit( qgetenv("FAKECSYNC") );
+    QString error;
+    if( !env.isEmpty() && !parseConfig( env, &globalConfig, &error ) ) {
+        qWarning() << "FAKECSYNC:" << error;
+    }
+}
+
+void setError( CSYNC *ctx, CSYNC_ERROR_CODE err, const char *str )
+{
+    ctx->error = err;
+    ctx->errorString = str;
+}
+
+bool aborted( CSYNC *ctx )
+{
+    if( ctx->abort ) {
+        setError( ctx, CSYNC_ERR_UNSPEC, "Aborted by request" );
+        return true;
+    }
+    return false;
+}
+
+/*
+ * Adds usec to the time the context owes and sleeps it off in pieces,
+ * returns false on an abort request.
+ */
+bool spend( CSYNC *ctx, qint64 usec )
+{
+    ctx->sleepDebt += usec;
+    while( ctx->sleepDebt >= 1000 ) {
+        if( aborted( ctx ) ) return false;
+        const qint64 slice = qMin( ctx->sleepDebt, qint64(MAX_SLEEP_USEC) );
+        Sleeper::sleepUsec( slice );
+        ctx->sleepDebt -= slice;
+    }
+    return !aborted( ctx );
+}
+
+// true if the current run of ctx is to fail in phase, sets the error
+bool injectFailure( CSYNC *ctx, Phase phase, int counter )
+{
+    const Config& cfg = ctx->config;
+    if( cfg.failPhase != phase || cfg.failEvery <= 0 || counter % cfg.failEvery != 0 ) {
+        return false;
+    }
+    setError( ctx, CSYNC_ERROR_CODE(cfg.failError), "Injected failure" );
+    return true;
+}
+
+unsigned mix( unsigned x )
+{
+    x ^= x >> 16;
+    x *= 0x7feb352dU;
+    x ^= x >> 15;
+    x *= 0x846ca68bU;
+    x ^= x >> 16;
+    return x;
+}
+
+// deterministic value in [0, 1) per file, run and purpose
+double fraction( unsigned seed, int i, unsigned salt )
+{
+    return mix( mix( unsigned(i) ^ seed ) + salt ) / 4294967296.0;
+}
+
+Change changeOf( CSYNC *ctx, int i )
+{
+    const Config& cfg = ctx->config;
+    double u = fraction( ctx->runSeed, i, 0x9e3779b9U );
+    const double shares[] = { cfg.newLocal, cfg.newRemote, cfg.changedLocal, cfg.changedRemote,
+                              cfg.removedLocal, cfg.removedRemote, cfg.renamed, cfg.conflicts };
+    for( int c = 0; c < int(sizeof(shares)/sizeof(shares[0])); c++ ) {
+        if( u < shares[c] ) return Change(c+1);
+        u -= shares[c];
+    }
+    return InSync;
+}
+
+bool failsToPropagate( CSYNC *ctx, int i )
+{
+    return fraction( ctx->runSeed, i, 0x85ebca6bU ) < ctx->config.fileErrors;
+}
+
+/*
+ * the instruction of file i in one of the trees after reconcile, false if
+ * the file is not in that tree.
+ */
+bool instructionOf( Change change, bool remote, enum csync_instructions_e *instr )
+{
+    switch( change ) {
+    case InSync:
+        *instr = CSYNC_INSTRUCTION_NONE;
+        return true;
+    case NewLocal:
+        *instr = CSYNC_INSTRUCTION_NEW;
+        return !remote;
+    case NewRemote:
+        *instr = CSYNC_INSTRUCTION_NEW;
+        return remote;
+    case ChangedLocal:
+        *instr = remote ? CSYNC_INSTRUCTION_NONE : CSYNC_INSTRUCTION_SYNC;
+        return true;
+    case ChangedRemote:
+        *instr = remote ? CSYNC_INSTRUCTION_SYNC : CSYNC_INSTRUCTION_NONE;
+        return true;
+    case RemovedLocal:
+        // gone locally, the remote file gets removed
+        *instr = CSYNC_INSTRUCTION_REMOVE;
+        return remote;
+    case RemovedRemote:
+        *instr = CSYNC_INSTRUCTION_REMOVE;
+        return !remote;
+    case Renamed:
+        *instr = remote ? CSYNC_INSTRUCTION_NONE : CSYNC_INSTRUCTION_RENAME;
+        return true;
+    case Conflict:
+        *instr = CSYNC_INSTRUCTION_CONFLICT;
+        return true;
+    }
+    return false;
+}
+
+// the instruction after propagation
+enum csync_instructions_e propagated( CSYNC *ctx, int i, enum csync_instructions_e instr )
+{
+    switch( instr ) {
+    case CSYNC_INSTRUCTION_NONE:
+        return instr;
+    case CSYNC_INSTRUCTION_REMOVE:
+        return failsToPropagate( ctx, i ) ? CSYNC_INSTRUCTION_ERROR : CSYNC_INSTRUCTION_DELETED;
+    default:
+        return failsToPropagate( ctx, i ) ? CSYNC_INSTRUCTION_ERROR : CSYNC_INSTRUCTION_UPDATED;
+    }
+}
+
+// "d<top>/d<n>/.../" for the directory of file i
+int directoryOf( const Config& cfg, int i, char *buf, int len )
+{
+    if( cfg.depth <= 0 ) {
+        buf[0] = 0;
+        return 0;
+    }
+    int dirIndex = i / qMax( 1, cfg.filesPerDir );
+    const int fanOut = qMax( 1, cfg.dirsPerDir );
+    int components[32];
+    const int depth = qMin( cfg.depth, 32 );
+    for( int level = depth-1; level > 0; level-- ) {
+        components[level] = dirIndex % fanOut;
+        dirIndex /= fanOut;
+    }
+    components[0] = dirIndex;
+
+    int pos = 0;
+    for( int level = 0; level < depth && pos < len; level++ ) {
+        pos += qsnprintf( buf+pos, len-pos, "d%d/", components[level] );
+    }
+    return qMin( pos, len-1 );
+}
+
+int walkTree( CSYNC *ctx, csync_treewalk_visit_func *visitor, int filter, bool remote )
+{
+    if( !ctx || !visitor ) return -1;
+    if( ctx->state < Reconciled ) {
+        setError( ctx, CSYNC_ERR_TREE, "No reconciled tree to walk" );
+        return -1;
+    }
+    const Config& cfg = ctx->config;
+
+    char path[512];
+    char renamePath[512];
+    int dirLen = 0;
+    int lastDir = -1;
+    qint64 nodes = 0;
+    int re = 0;
+
+    for( int i = 0; i < cfg.files && re == 0; i++ ) {
+        enum csync_instructions_e instr;
+        if( !instructionOf( changeOf( ctx, i ), remote, &instr ) ) {
+            continue;
+        }
+        if( ctx->state == Propagated ) {
+            instr = propagated( ctx, i, instr );
+        }
+        if( filter && (filter & instr) == 0 ) {
+            continue;
+        }
+
+        const int dir = i / qMax( 1, cfg.filesPerDir );
+        if( dir != lastDir ) {
+            dirLen = directoryOf( cfg, i, path, sizeof(path) );
+            lastDir = dir;
+        }
+        qsnprintf( path+dirLen, sizeof(path)-dirLen, "f%d.dat", i );
+
+        TREE_WALK_FILE file;
+        memset( &file, 0, sizeof(file) );
+        file.path = path;
+        file.modtime = FAKE_MTIME;
+        file.mode = S_IFREG | 0644;
+        file.type = CSYNC_FTW_TYPE_FILE;
+        file.instruction = instr;
+#ifdef HAVE_TREE_WALK_FILE_SIZE
+        file.size = cfg.fileSize;
+#endif
+        if( instr == CSYNC_INSTRUCTION_RENAME ) {
+            memcpy( renamePath, path, dirLen );
+            qsnprintf( renamePath+dirLen, sizeof(renamePath)-dirLen, "r%d.dat", i );
+            file.rename_path = renamePath;
+        }
+
+        nodes++;
+        if( visitor( &file, ctx->userdata ) < 0 ) {
+            re = -1;
+        }
+    }
+
+    QMutexLocker locker( &mutex );
+    globalStats.walkedNodes += nodes;
+    return re;
+}
+
+void notify( CSYNC *ctx, const QByteArray& url, enum csync_notify_type_e kind, long long o1, long long o2 )
+{
+    if( ctx->progressCallback ) {
+        ctx->progressCallback( url.constData(), kind, o1, o2, ctx->userdata );
+    }
+}
+
+}
+
+namespace FakeCSync {
+
+Config::Config()
+    : files(10000),
+      filesPerDir(100),
+      dirsPerDir(10),
+      depth(2),
+      fileSize(4096),
+      newLocal(0.01),
+      newRemote(0.01),
+      changedLocal(0.01),
+      changedRemote(0.01),
+      removedLocal(0.0),
+      removedRemote(0.0),
+      renamed(0.0),
+      conflicts(0.0),
+      fileErrors(0.0),
+      initMsec(0),
+      updateUsecPerFile(0),
+      reconcileUsecPerFile(0),
+      propagateUsecPerFile(0),
+      commitMsec(0),
+      failPhase(NoPhase),
+      failError(CSYNC_ERR_UNSPEC),
+      failEvery(0),
+      seed(1),
+      churn(true)
+{
+}
+
+Stats::Stats()
+    : contexts(0),
+      runs(0),
+      failedRuns(0),
+      walkedNodes(0),
+      uploads(0),
+      downloads(0),
+      removes(0),
+      renames(0),
+      fileErrors(0)
+{
+}
+
+void setConfig( const Config& cfg )
+{
+    QMutexLocker locker( &mutex );
+    configRead = true;
+    globalConfig = cfg;
+}
+
+Config config()
+{
+    QMutexLocker locker( &mutex );
+    readEnvironment();
+    return globalConfig;
+}
+
+bool parseConfig( const QString& str, Config *cfg, QString *error )
+{
+    struct IntField    { const char *name; int Config::*member; };
+    struct DoubleField { const char *name; double Config::*member; };
+
+    static const IntField intFields[] = {
+        { "files", &Config::files },
+        { "filesPerDir", &Config::filesPerDir },
+        { "dirsPerDir", &Config::dirsPerDir },
+        { "depth", &Config::depth },
+        { "initMsec", &Config::initMsec },
+        { "updateUsecPerFile", &Config::updateUsecPerFile },
+        { "reconcileUsecPerFile", &Config::reconcileUsecPerFile },
+        { "propagateUsecPerFile", &Config::propagateUsecPerFile },
+        { "commitMsec", &Config::commitMsec },
+        { "failError", &Config::failError },
+        { "failEvery", &Config::failEvery }
+    };
+    static const DoubleField doubleFields[] = {
+        { "newLocal", &Config::newLocal },
+        { "newRemote", &Config::newRemote },
+        { "changedLocal", &Config::changedLocal },
+        { "changedRemote", &Config::changedRemote },
+        { "removedLocal", &Config::removedLocal },
+        { "removedRemote", &Config::removedRemote },
+        { "renamed", &Config::renamed },
+        { "conflicts", &Config::conflicts },
+        { "fileErrors", &Config::fileErrors }
+    };
+
+    foreach( const QString& pair, str.split( QLatin1Char(','), QString::SkipEmptyParts ) ) {
+        const QString key   = pair.section( QLatin1Char('='), 0, 0 ).trimmed();
+        const QString value = pair.section( QLatin1Char('='), 1 ).trimmed();
+        bool ok = false;
+        bool known = false;
+
+        for( uint f = 0; f < sizeof(intFields)/sizeof(intFields[0]) && !known; f++ ) {
+            if( key == QLatin1String(intFields[f].name) ) {
+                cfg->*(intFields[f].member) = value.toInt( &ok );
+                known = true;
+            }
+        }
+        for( uint f = 0; f < sizeof(doubleFields)/sizeof(doubleFields[0]) && !known; f++ ) {
+            if( key == QLatin1String(doubleFields[f].name) ) {
+                cfg->*(doubleFields[f].member) = value.toDouble( &ok );
+                known = true;
+            }
+        }
+        if( known ) {
+            // checked below
+        } else if( key == QLatin1String("fileSize") ) {
+            cfg->fileSize = value.toLongLong( &ok );
+        } else if( key == QLatin1String("seed") ) {
+            cfg->seed = value.toUInt( &ok );
+        } else if( key == QLatin1String("churn") ) {
+            cfg->churn = value != QLatin1String("0") && value != QLatin1String("false");
+            ok = true;
+        } else if( key == QLatin1String("failPhase") ) {
+            const QStringList phases = QStringList() << QLatin1String("none") << QLatin1String("init")
+                                                     << QLatin1String("update") << QLatin1String("reconcile")
+                                                     << QLatin1String("propagate");
+            int phase = phases.indexOf( value );
+            ok = phase >= 0;
+            if( ok ) cfg->failPhase = Phase(phase);
+        } else {
+            if( error ) *error = QString::fromLatin1("unknown field %1").arg( key );
+            return false;
+        }
+        if( !ok ) {
+            if( error ) *error = QString::fromLatin1("invalid value for %1: %2").arg( key, value );
+            return false;
+        }
+    }
+    return true;
+}
+
+Stats stats()
+{
+    QMutexLocker locker( &mutex );
+    return globalStats;
+}
+
+void resetStats()
+{
+    QMutexLocker locker( &mutex );
+    globalStats = Stats();
+}
+
+}
+
+/*
+ * The csync API, as far as the sync library uses it.
+ */
+
+int csync_create( CSYNC **csync, const char *local, const char *remote )
+{
+    if( !csync || !local || !remote ) return -1;
+
+    CSYNC *ctx = new csync_s;
+    ctx->local = local;
+    ctx->remote = remote;
+    ctx->config = FakeCSync::config();
+    ctx->state = Created;
+    ctx->runs = 0;
+    ctx->runSeed = ctx->config.seed;
+    ctx->userdata = 0;
+    ctx->authCallback = 0;
+    ctx->logCallback = 0;
+    ctx->progressCallback = 0;
+    ctx->logVerbosity = 0;
+    ctx->error = CSYNC_ERR_NONE;
+    ctx->sleepDebt = 0;
+    {
+        QMutexLocker locker( &mutex );
+        ctx->number = ++globalStats.contexts;
+    }
+    *csync = ctx;
+    return 0;
+}
+
+int csync_init( CSYNC *ctx )
+{
+    if( !ctx ) return -1;
+    if( ctx->state != Created ) {
+        setError( ctx, CSYNC_ERR_PARAM, "Context is already initialized" );
+        return 1;
+    }
+    if( !spend( ctx, qint64(ctx->config.initMsec) * 1000 ) ||
+        injectFailure( ctx, InitPhase, ctx->number ) ) {
+        return -1;
+    }
+    ctx->state = Initialized;
+    return 0;
+}
+
+int csync_update( CSYNC *ctx )
+{
+    if( !ctx ) return -1;
+    if( ctx->state < Initialized ) {
+        setError( ctx, CSYNC_ERR_PARAM, "Context is not initialized" );
+        return -1;
+    }
+    ctx->error = CSYNC_ERR_NONE;
+    ctx->runs++;
+    if( ctx->config.churn ) {
+        ctx->runSeed = ctx->config.seed + ctx->runs - 1;
+    }
+    {
+        QMutexLocker locker( &mutex );
+        globalStats.runs++;
+    }
+    if( !spend( ctx, qint64(ctx->config.updateUsecPerFile) * ctx->config.files ) ||
+        injectFailure( ctx, UpdatePhase, ctx->runs ) ) {
+        QMutexLocker locker( &mutex );
+        globalStats.failedRuns++;
+        return -1;
+    }
+    ctx->state = Updated;
+    return 0;
+}
+
+int csync_reconcile( CSYNC *ctx )
+{
+    if( !ctx ) return -1;
+    if( ctx->state != Updated ) {
+        setError( ctx, CSYNC_ERR_RECONCILE, "Reconcile without update" );
+        return -1;
+    }
+    if( !spend( ctx, qint64(ctx->config.reconcileUsecPerFile) * ctx->config.files ) ||
+        injectFailure( ctx, ReconcilePhase, ctx->runs ) ) {
+        QMutexLocker locker( &mutex );
+        globalStats.failedRuns++;
+        return -1;
+    }
+    ctx->state = Reconciled;
+    return 0;
+}
+
+int csync_propagate( CSYNC *ctx )
+{
+    if( !ctx ) return -1;
+    if( ctx->state != Reconciled ) {
+        setError( ctx, CSYNC_ERR_PROPAGATE, "Propagate without reconcile" );
+        return -1;
+    }
+    const Config& cfg = ctx->config;
+    Stats run;
+    bool ok = true;
+
+    for( int i = 0; i < cfg.files && ok; i++ ) {
+        const Change change = changeOf( ctx, i );
+        if( change == InSync ) continue;
+
+        if( !spend( ctx, cfg.propagateUsecPerFile ) ) {
+            ok = false;
+            break;
+        }
+        const bool failed = failsToPropagate( ctx, i );
+        if( failed ) run.fileErrors++;
+
+        switch( change ) {
+        case NewLocal:
+        case ChangedLocal:
+            notify( ctx, QByteArray(), CSYNC_NOTIFY_START_UPLOAD, 0, 0 );
+            if( failed ) break;
+            notify( ctx, QByteArray(), CSYNC_NOTIFY_PROGRESS, cfg.fileSize, cfg.fileSize );
+            notify( ctx, QByteArray(), CSYNC_NOTIFY_FINISHED_UPLOAD, 0, 0 );
+            run.uploads++;
+            break;
+        case NewRemote:
+        case ChangedRemote:
+        case Conflict: {
+            char path[512];
+            const int dirLen = directoryOf( cfg, i, path, sizeof(path) );
+            qsnprintf( path+dirLen, sizeof(path)-dirLen, "f%d.dat", i );
+            const QByteArray url = ctx->remote + '/' + path;
+            notify( ctx, url, CSYNC_NOTIFY_START_DOWNLOAD, 0, 0 );
+            if( failed ) break;
+            notify( ctx, url, CSYNC_NOTIFY_PROGRESS, cfg.fileSize, cfg.fileSize );
+            notify( ctx, url, CSYNC_NOTIFY_FINISHED_DOWNLOAD, 0, 0 );
+            run.downloads++;
+            break;
+        }
+        case RemovedLocal:
+        case RemovedRemote:
+            if( !failed ) run.removes++;
+            break;
+        case Renamed:
+            if( !failed ) run.renames++;
+            break;
+        case InSync:
+            break;
+        }
+    }
+    if( ok && injectFailure( ctx, PropagatePhase, ctx->runs ) ) {
+        ok = false;
+    }
+
+    QMutexLocker locker( &mutex );
+    globalStats.uploads += run.uploads;
+    globalStats.downloads += run.downloads;
+    globalStats.removes += run.removes;
+    globalStats.renames += run.renames;
+    globalStats.fileErrors += run.fileErrors;
+    if( !ok ) {
+        globalStats.failedRuns++;
+        return -1;
+    }
+    ctx->state = Propagated;
+    return 0;
+}
+
+int csync_commit( CSYNC *ctx )
+{
+    if( !ctx ) return -1;
+    spend( ctx, qint64(ctx->config.commitMsec) * 1000 );
+    // like csync, the trees are dropped and the context is ready for the next run
+    if( ctx->state > Initialized ) {
+        ctx->state = Initialized;
+    }
+    ctx->sleepDebt = 0;
+    return 0;
+}
+
+int csync_destroy( CSYNC *ctx )
+{
+    delete ctx;
+    return 0;
+}
+
+int csync_walk_local_tree( CSYNC *ctx, csync_treewalk_visit_func *visitor, int filter )
+{
+    return walkTree( ctx, visitor, filter, false );
+}
+
+int csync_walk_remote_tree( CSYNC *ctx, csync_treewalk_visit_func *visitor, int filter )
+{
+    return walkTree( ctx, visitor, filter, true );
+}
+
+int csync_add_exclude_list( CSYNC *ctx, const char *path )
+{
+    return ctx && path ? 0 : -1;
+}
+
+int csync_set_config_dir( CSYNC *ctx, const char *path )
+{
+    if( !ctx || !path ) return -1;
+    ctx->configDir = path;
+    return 0;
+}
+
+int csync_enable_conflictcopys( CSYNC *ctx )
+{
+    return ctx ? 0 : -1;
+}
+
+int csync_set_userdata( CSYNC *ctx, void *userdata )
+{
+    if( !ctx ) return -1;
+    ctx->userdata = userdata;
+    return 0;
+}
+
+int csync_set_auth_callback( CSYNC *ctx, csync_auth_callback cb )
+{
+    if( !ctx ) return -1;
+    ctx->authCallback = cb;
+    return 0;
+}
+
+int csync_set_log_callback( CSYNC *ctx, csync_log_callback cb )
+{
+    if( !ctx ) return -1;
+    ctx->logCallback = cb;
+    return 0;
+}
+
+int csync_set_log_verbosity( CSYNC *ctx, int verbosity )
+{
+    if( !ctx ) return -1;
+    ctx->logVerbosity = verbosity;
+    return 0;
+}
+
+int csync_set_progress_callback( CSYNC *ctx, csync_progress_callback cb )
+{
+    if( !ctx ) return -1;
+    ctx->progressCallback = cb;
+    return 0;
+}
+
+int csync_set_module_property( CSYNC *ctx, const char *key, void *value )
+{
+    // proxy, chunking and bandwidth limits have no meaning here
+    Q_UNUSED(value);
+    return ctx && key ? 0 : -1;
+}
+
+CSYNC_ERROR_CODE csync_get_error( CSYNC *ctx )
+{
+    return ctx ? ctx->error : CSYNC_ERR_PARAM;
+}
+
+const char *csync_get_error_string( CSYNC *ctx )
+{
+    return ctx && !ctx->errorString.isEmpty() ? ctx->errorString.constData() : 0;
+}
+
+void csync_request_abort( CSYNC *ctx )
+{
+    if( ctx ) ctx->abort = 1;
+}
+
+void csync_resume( CSYNC *ctx )
+{
+    if( ctx ) ctx->abort = 0;
+}
@@ -0,0 +1,110 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#ifndef MIRALL_FAKECSYNC_H
+#define MIRALL_FAKECSYNC_H
+
+#include <QString>
+
+/**
+ * A test double of the csync C API. It implements the functions of csync.h
+ * the sync library calls, without files and without a server: csync_update
+ * synthesises a local and a remote tree from the configuration below,
+ * csync_propagate reports the transfers through the progress callback.
+ *
+ * The trees are not kept in memory, every walk derives the files from their
+ * index, so a million items cost the double next to nothing and the memory
+ * of a run is the one of the sync library.
+ *
+ * Linked into owncloudsync_fakecsync instead of the real csync library.
+ */
+namespace FakeCSync {
+
+enum Phase {
+    NoPhase = 0,
+    InitPhase,
+    UpdatePhase,
+    ReconcilePhase,
+    PropagatePhase
+};
+
+struct Config {
+    Config();
+
+    // shape of the trees: files in directories of filesPerDir files,
+    // dirsPerDir subdirectories per level, depth levels.
+    int    files;
+    int    filesPerDir;
+    int    dirsPerDir;
+    int    depth;
+    qint64 fileSize;
+
+    // share of the files with an instruction, the others are in sync
+    double newLocal;
+    double newRemote;
+    double changedLocal;
+    double changedRemote;
+    double removedLocal;
+    double removedRemote;
+    double renamed;
+    double conflicts;
+    // share of the propagated files that end with an error
+    double fileErrors;
+
+    // latencies, the per file ones add up over the tree
+    int initMsec;
+    int updateUsecPerFile;
+    int reconcileUsecPerFile;
+    int propagateUsecPerFile;
+    int commitMsec;
+
+    // every failEvery-th run fails in failPhase with failError, a
+    // CSYNC_ERROR_CODE. failEvery 0 never fails.
+    Phase failPhase;
+    int   failError;
+    int   failEvery;
+
+    unsigned seed;
+    // other files change in every run, otherwise every run reports the same
+    bool  churn;
+};
+
+/**
+ * Counters over all contexts, e.g. to compare the requests a real server
+ * would see.
+ */
+struct Stats {
+    Stats();
+
+    int    contexts;
+    int    runs;
+    int    failedRuns;
+    qint64 walkedNodes;
+    qint64 uploads;
+    qint64 downloads;
+    qint64 removes;
+    qint64 renames;
+    qint64 fileErrors;
+};
+
+// the configuration of the contexts created from now on. The initial one is
+// read from the FAKECSYNC environment variable.
+void setConfig( const Config& );
+Config config();
+
+/**
+ * parses a configuration like "files=1000000,depth=3,newRemote=0.01" into
+ * cfg, the fields have the names of Config. failPhase takes init, update,
+ * reconcile or propagate. Returns false and sets error on unknown fields.
+ */
+bool parseConfig( const QString& str, Config *cfg, QString *error );
+
+Stats stats();
+void resetStats();
+
+}
+
+#endif
@@ -1,4 +1,6 @@
-macro(owncloud_add_test test_class)
+# builds <test_class>Test from test<test_class>.h, without registering it
+# with ctest. Extra arguments are linked.
+macro(owncloud_build_test test_class)
     include_directories(${QT_INCLUDES} "${PROJECT_SOURCE_DIR}/src" ${CMAKE_CURRENT_BINARY_DIR})
 
     set(OWNCLOUD_TEST_CLASS ${test_class})
@@ -13,7 +15,11 @@ macro(owncloud_add_test test_class)
 
         ${QT_QTTEST_LIBRARY}
         ${QT_QTCORE_LIBRARY}
+        ${ARGN}
     )
+endmacro()
 
-    add_test(NAME ${OWNCLOUD_TEST_CLASS}Test COMMAND ${OWNCLOUD_TEST_CLASS}Test)
-endmacro()
\ No newline at end of file
+macro(owncloud_add_test test_class)
+    owncloud_build_test(${test_class} ${ARGN})
+    add_test(NAME ${test_class}Test COMMAND ${test_class}Test)
+endmacro()
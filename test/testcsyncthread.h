@@ -0,0 +1,73 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#ifndef MIRALL_TESTCSYNCTHREAD_H
+#define MIRALL_TESTCSYNCTHREAD_H
+
+#include <QtTest>
+
+#include "mirall/csyncthread.h"
+#include "fakecsync.h"
+
+using namespace Mirall;
+
+/*
+ * Runs CSyncThread on the csync test double, startSync() is called in the
+ * test thread.
+ */
+class TestCSyncThread : public QObject
+{
+    Q_OBJECT
+
+private:
+    CSYNC *_ctx;
+
+private slots:
+    void initTestCase()
+    {
+        qRegisterMetaType<SyncFileItemVector>("SyncFileItemVector");
+        // the default trees, whatever FAKECSYNC says
+        FakeCSync::setConfig( FakeCSync::Config() );
+
+        _ctx = 0;
+        QVERIFY( csync_create( &_ctx, "/fake/local", "owncloud://fake/remote" ) == 0 );
+        QVERIFY( csync_init( _ctx ) == 0 );
+    }
+
+    void cleanupTestCase()
+    {
+        csync_destroy( _ctx );
+    }
+
+    void testUnlimitedRunReportsItems()
+    {
+        CSyncThread thread( _ctx );
+        QSignalSpy deferred( &thread, SIGNAL(transferDeferred(qint64)) );
+        QSignalSpy walked( &thread, SIGNAL(treeWalkResult(SyncFileItemVector)) );
+
+        thread.startSync();
+        QCOMPARE( deferred.count(), 0 );
+        QCOMPARE( walked.count(), 1 );
+    }
+
+    void testDeferredRunReportsNoItems()
+    {
+        CSyncThread thread( _ctx );
+        thread.setBulkTransferLimit( 1 );
+        QSignalSpy deferred( &thread, SIGNAL(transferDeferred(qint64)) );
+        QSignalSpy walked( &thread, SIGNAL(treeWalkResult(SyncFileItemVector)) );
+        QSignalSpy finished( &thread, SIGNAL(finished()) );
+
+        thread.startSync();
+        QCOMPARE( deferred.count(), 1 );
+        QVERIFY( deferred.at(0).at(0).toLongLong() > 1 );
+        // planned items must not replace the ones of the last real run
+        QCOMPARE( walked.count(), 0 );
+        QCOMPARE( finished.count(), 1 );
+    }
+};
+
+#endif
@@ -0,0 +1,291 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#ifndef MIRALL_TESTSYNCCOREBENCHMARK_H
+#define MIRALL_TESTSYNCCOREBENCHMARK_H
+
+#include <QtTest>
+
+#include <string.h>
+
+#include "mirall/csyncthread.h"
+#include "mirall/folderman.h"
+#include "mirall/folderwatcher.h"
+#include "mirall/mirallconfigfile.h"
+#include "mirall/owncloudfolder.h"
+#include "mirall/syncresult.h"
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include "mirall/inotify.h"
+#include "mirall/folderwatcher_inotify.h"
+#endif
+
+using namespace Mirall;
+
+// gives the benchmarks the tree walk step of CSyncThread
+class BenchCSyncThread : public CSyncThread
+{
+public:
+    BenchCSyncThread() : CSyncThread( 0 ) {}
+    using CSyncThread::treewalkFile;
+    using CSyncThread::syncedItemCount;
+};
+
+// the code under test logs every item, that would dominate the numbers.
+static void benchmarkMessageHandler( QtMsgType type, const char *msg )
+{
+    if( type != QtDebugMsg ) fprintf( stderr, "%s\n", msg );
+}
+
+/*
+ * Micro benchmarks of the code that runs for every file system event or
+ * every sync item. Run with -xml or -o <file>,xml to get the results in
+ * a machine readable form, "make microbenchmark" writes them to
+ * synccorebenchmark.xml in the build directory.
+ */
+class TestSyncCoreBenchmark : public QObject
+{
+    Q_OBJECT
+
+public slots:
+    void slotCountEvent( int, int, const QString& )
+    {
+        _events++;
+    }
+
+private:
+    QString _tmpDir;
+    int     _events;
+
+    static void addSizeRows( int maxCount )
+    {
+        QTest::addColumn<int>("count");
+        for( int count = 1000; count <= maxCount; count *= 10 ) {
+            QTest::newRow( qPrintable( QString::fromLatin1("%1k").arg(count/1000) ) ) << count;
+        }
+    }
+
+    static SyncFileItemVector makeItems( int count )
+    {
+        static const int instructions[] = { CSYNC_INSTRUCTION_NEW, CSYNC_INSTRUCTION_UPDATED,
+                                            CSYNC_INSTRUCTION_REMOVE, CSYNC_INSTRUCTION_CONFLICT };
+        SyncFileItemVector items;
+        items.reserve( count );
+        for( int i = 0; i < count; i++ ) {
+            SyncFileItem item;
+            item._file = QString::fromLatin1("dir%1/subdir%2/file%3.txt").arg(i/1000).arg(i/100).arg(i);
+            item._instruction = csync_instructions_e( instructions[i % 4] );
+            item._dir = (i % 2) ? SyncFileItem::Down : SyncFileItem::Up;
+            item._size = 1024 * (i % 64);
+            items.append( item );
+        }
+        return items;
+    }
+
+    static bool removeTree( const QString& path )
+    {
+        QFileInfo fi( path );
+        if( !fi.isDir() || fi.isSymLink() ) {
+            return QFile::remove( path );
+        }
+        QDir dir( path );
+        foreach( const QFileInfo& entry, dir.entryInfoList( QDir::AllEntries | QDir::Hidden | QDir::NoDotAndDotDot ) ) {
+            if( !removeTree( entry.absoluteFilePath() ) ) return false;
+        }
+        return QDir().rmdir( path );
+    }
+
+private slots:
+    void initTestCase()
+    {
+        qInstallMsgHandler( benchmarkMessageHandler );
+        _tmpDir = QDir::tempPath() + QString::fromLatin1("/synccorebench-%1").arg( QCoreApplication::applicationPid() );
+        QDir().mkpath( _tmpDir + QLatin1String("/conf") );
+        QDir().mkpath( _tmpDir + QLatin1String("/watched") );
+        // keep the configuration of the user out of the benchmarks
+        MirallConfigFile::setConfDir( _tmpDir + QLatin1String("/conf") );
+    }
+
+    void cleanupTestCase()
+    {
+        removeTree( _tmpDir );
+        qInstallMsgHandler( 0 );
+    }
+
+#ifdef Q_OS_LINUX
+    void benchIgnoreMatching_data()
+    {
+        addSizeRows( 100000 );
+    }
+
+    void benchIgnoreMatching()
+    {
+        QFETCH( int, count );
+
+        FolderWatcher watcher( _tmpDir + QLatin1String("/watched") );
+        foreach( const char *pattern, QList<const char*>() << "*~" << ".*.sw?" << "*.part"
+                 << ".csync_journal.db*" << ".~lock.*" << "~$*" << "*.tmp" << "Thumbs.db"
+                 << "desktop.ini" << ".DS_Store" ) {
+            watcher.addIgnore( QLatin1String(pattern) );
+        }
+        FolderWatcherPrivate d( &watcher );
+
+        QStringList paths;
+        for( int i = 0; i < count; i++ ) {
+            // every tenth path hits an ignore pattern
+            paths.append( QString::fromLatin1("%1/watched/dir%2/file%3.%4").arg(_tmpDir).arg(i/100).arg(i)
+                          .arg( i % 10 ? QLatin1String("txt") : QLatin1String("part") ) );
+        }
+
+        QBENCHMARK {
+            foreach( const QString& path, paths ) {
+                QMetaObject::invokeMethod( &d, "slotINotifyEvent", Qt::DirectConnection,
+                                           Q_ARG(int, IN_CLOSE_WRITE), Q_ARG(int, 0), Q_ARG(QString, path) );
+            }
+            watcher.clearPendingEvents();
+        }
+    }
+
+    void benchINotifyParsing_data()
+    {
+        // the kernel queues 16384 events by default
+        addSizeRows( 10000 );
+    }
+
+    void benchINotifyParsing()
+    {
+        QFETCH( int, count );
+
+        const QString dir = _tmpDir + QString::fromLatin1("/inotify%1").arg(count);
+        QDir().mkpath( dir );
+        QStringList files;
+        for( int i = 0; i < count; i++ ) {
+            QFile f( dir + QString::fromLatin1("/file%1").arg(i) );
+            f.open( QIODevice::WriteOnly );
+            files.append( f.fileName() );
+        }
+
+        INotify notify( 0, IN_ATTRIB );
+        notify.addPath( dir );
+        connect( &notify, SIGNAL(notifyEvent(int,int,QString)), SLOT(slotCountEvent(int,int,QString)) );
+
+        // includes the chmod calls that generate the events.
+        QBENCHMARK {
+            _events = 0;
+            foreach( const QString& file, files ) {
+                QFile::setPermissions( file, QFile::permissions(file) ^ QFile::ExeOwner );
+            }
+            while( _events < count ) {
+                QMetaObject::invokeMethod( &notify, "slotActivated", Qt::DirectConnection, Q_ARG(int, 0) );
+            }
+        }
+        removeTree( dir );
+    }
+#endif
+
+    void benchEscapeAlias_data()
+    {
+        addSizeRows( 1000000 );
+    }
+
+    void benchEscapeAlias()
+    {
+        QFETCH( int, count );
+
+        QStringList aliases;
+        for( int i = 0; i < count; i++ ) {
+            aliases.append( QString::fromLatin1("Folder %1: docs/[2013] *draft* %2%").arg(i).arg(i % 7) );
+        }
+
+        QBENCHMARK {
+            foreach( const QString& alias, aliases ) {
+                FolderMan::unescapeAlias( FolderMan::escapeAlias( alias ) );
+            }
+        }
+    }
+
+    void benchSyncResultCopy_data()
+    {
+        QTest::addColumn<int>("count");
+        QTest::addColumn<bool>("detach");
+        for( int count = 1000; count <= 1000000; count *= 10 ) {
+            QString tag = QString::fromLatin1("%1k").arg(count/1000);
+            QTest::newRow( qPrintable(tag + QLatin1String(" shared")) ) << count << false;
+            QTest::newRow( qPrintable(tag + QLatin1String(" detached")) ) << count << true;
+        }
+    }
+
+    void benchSyncResultCopy()
+    {
+        QFETCH( int, count );
+        QFETCH( bool, detach );
+
+        SyncResult result( SyncResult::Success );
+        result.setSyncFileItemVector( makeItems(count) );
+
+        QBENCHMARK {
+            SyncResult copy( result );
+            if( detach ) {
+                SyncFileItemVector items = copy.syncFileItemVector();
+                items[0]._size = 0;
+            }
+        }
+    }
+
+    void benchTreewalkFile_data()
+    {
+        addSizeRows( 1000000 );
+    }
+
+    void benchTreewalkFile()
+    {
+        QFETCH( int, count );
+
+        QList<QByteArray> paths;
+        for( int i = 0; i < count; i++ ) {
+            paths.append( QString::fromLatin1("dir%1/subdir%2/file%3.txt").arg(i/1000).arg(i/100).arg(i).toUtf8() );
+        }
+        QVector<TREE_WALK_FILE> files( count );
+        for( int i = 0; i < count; i++ ) {
+            memset( &files[i], 0, sizeof(TREE_WALK_FILE) );
+            files[i].path = paths.at(i).constData();
+            files[i].instruction = (i % 3) ? CSYNC_INSTRUCTION_NEW : CSYNC_INSTRUCTION_SYNC;
+        }
+
+        // a fresh thread per iteration, the items of the last one are freed
+        // in the loop like a new run clears them.
+        int items = 0;
+        QBENCHMARK {
+            BenchCSyncThread thread;
+            for( int i = 0; i < count; i++ ) {
+                thread.treewalkFile( &files[i], true );
+            }
+            items = thread.syncedItemCount();
+        }
+        QCOMPARE( items, count );
+    }
+
+    void benchServerActionNotifier_data()
+    {
+        addSizeRows( 1000000 );
+    }
+
+    void benchServerActionNotifier()
+    {
+        QFETCH( int, count );
+
+        SyncResult result( SyncResult::Success );
+        result.setSyncFileItemVector( makeItems(count) );
+        ServerActionNotifier notifier;
+
+        QBENCHMARK {
+            notifier.slotSyncFinished( result );
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,166 @@
+/*
+   This software is in the public domain, furnished "as is", without technical
+   support, and with no warranty, express or implied, as to its usefulness for
+   any purpose.
+*/
+
+#ifndef MIRALL_TESTSYNCSCHEDULER_H
+#define MIRALL_TESTSYNCSCHEDULER_H
+
+#include <QtTest>
+
+#include "mirall/syncscheduler.h"
+
+using namespace Mirall;
+
+class TestSyncScheduler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testEmpty()
+    {
+        SyncScheduler sched;
+        QCOMPARE( sched.depth(), 0 );
+        QVERIFY( sched.takeNext( 0 ).isEmpty() );
+
+        // an empty alias is never queued
+        sched.enqueue( QString(), Folder::LocalChange, 1.0, 0 );
+        QCOMPARE( sched.depth(), 0 );
+    }
+
+    void testReasonOrder()
+    {
+        SyncScheduler sched;
+        sched.enqueue( "poll",   Folder::Poll,         1.0, 0 );
+        sched.enqueue( "remote", Folder::RemoteChange, 1.0, 0 );
+        sched.enqueue( "local",  Folder::LocalChange,  1.0, 0 );
+        QCOMPARE( sched.depth(), 3 );
+
+        QCOMPARE( sched.takeNext( 0 ), QString("local") );
+        QCOMPARE( sched.takeNext( 0 ), QString("remote") );
+        QCOMPARE( sched.takeNext( 0 ), QString("poll") );
+        QVERIFY( sched.takeNext( 0 ).isEmpty() );
+    }
+
+    void testSameReasonIsFifo()
+    {
+        SyncScheduler sched;
+        sched.enqueue( "a", Folder::Poll, 1.0, 0 );
+        sched.enqueue( "b", Folder::Poll, 1.0, 10 );
+        sched.enqueue( "c", Folder::Poll, 1.0, 20 );
+
+        QCOMPARE( sched.takeNext( 30 ), QString("a") );
+        QCOMPARE( sched.takeNext( 30 ), QString("b") );
+        QCOMPARE( sched.takeNext( 30 ), QString("c") );
+    }
+
+    void testAging()
+    {
+        SyncScheduler sched;
+        sched.setAgingInterval( 1000 );
+        QCOMPARE( sched.agingInterval(), qint64(1000) );
+
+        // waited one and a half levels, not yet enough to pass a local change
+        sched.enqueue( "old", Folder::Poll,        1.0, 0 );
+        sched.enqueue( "new", Folder::LocalChange, 1.0, 1500 );
+        QCOMPARE( sched.takeNext( 1500 ), QString("new") );
+        QCOMPARE( sched.takeNext( 1500 ), QString("old") );
+
+        // after more than two levels the poll goes first
+        sched.enqueue( "old", Folder::Poll,        1.0, 0 );
+        sched.enqueue( "new", Folder::LocalChange, 1.0, 2500 );
+        QCOMPARE( sched.takeNext( 2500 ), QString("old") );
+        QCOMPARE( sched.takeNext( 2500 ), QString("new") );
+    }
+
+    void testWeightAgesFaster()
+    {
+        SyncScheduler sched;
+        sched.setAgingInterval( 1000 );
+
+        // same reason and waiting time, the heavier folder climbs faster
+        sched.enqueue( "light", Folder::Poll, 1.0, 0 );
+        sched.enqueue( "heavy", Folder::Poll, 3.0, 0 );
+        QCOMPARE( sched.takeNext( 500 ), QString("heavy") );
+
+        // a weight of zero or less counts as one
+        sched.enqueue( "zero", Folder::Poll, 0.0, 0 );
+        QCOMPARE( sched.takeNext( 500 ), QString("light") );
+        QCOMPARE( sched.takeNext( 500 ), QString("zero") );
+    }
+
+    void testReenqueueKeepsOneEntry()
+    {
+        SyncScheduler sched;
+        sched.enqueue( "a", Folder::Poll, 1.0, 0 );
+        sched.enqueue( "b", Folder::Poll, 1.0, 100 );
+        sched.enqueue( "a", Folder::Poll, 1.0, 200 );
+        sched.enqueue( "a", Folder::Poll, 1.0, 300 );
+
+        QCOMPARE( sched.depth(), 2 );
+        QCOMPARE( sched.aliases(), QStringList() << "a" << "b" );
+
+        // the entry keeps its first enqueue time
+        QCOMPARE( sched.takeNext( 400 ), QString("a") );
+        QCOMPARE( sched.lastWaitTime(), qint64(400) );
+    }
+
+    void testReenqueueRaisesReason()
+    {
+        SyncScheduler sched;
+        sched.enqueue( "a", Folder::Poll,         1.0, 0 );
+        sched.enqueue( "b", Folder::RemoteChange, 1.0, 0 );
+        sched.enqueue( "a", Folder::LocalChange,  1.0, 10 );
+        QCOMPARE( sched.depth(), 2 );
+
+        QCOMPARE( sched.takeNext( 10 ), QString("a") );
+        QCOMPARE( sched.takeNext( 10 ), QString("b") );
+    }
+
+    void testReenqueueNeverLowersReason()
+    {
+        SyncScheduler sched;
+        sched.enqueue( "a", Folder::LocalChange,  1.0, 10 );
+        sched.enqueue( "b", Folder::RemoteChange, 1.0, 0 );
+        sched.enqueue( "a", Folder::Poll,         1.0, 20 );
+        QCOMPARE( sched.depth(), 2 );
+
+        QCOMPARE( sched.takeNext( 20 ), QString("a") );
+        QCOMPARE( sched.takeNext( 20 ), QString("b") );
+    }
+
+    void testRemove()
+    {
+        SyncScheduler sched;
+        sched.enqueue( "a", Folder::LocalChange, 1.0, 0 );
+        sched.enqueue( "b", Folder::Poll,        1.0, 0 );
+        QVERIFY( sched.contains( "a" ) );
+
+        sched.remove( "a" );
+        QVERIFY( !sched.contains( "a" ) );
+        QCOMPARE( sched.depth(), 1 );
+        QCOMPARE( sched.takeNext( 0 ), QString("b") );
+
+        sched.enqueue( "c", Folder::Poll, 1.0, 0 );
+        sched.clear();
+        QCOMPARE( sched.depth(), 0 );
+    }
+
+    void testWaitStatistics()
+    {
+        SyncScheduler sched;
+        QCOMPARE( sched.averageWaitTime(), qint64(0) );
+
+        sched.enqueue( "a", Folder::Poll, 1.0, 0 );
+        sched.takeNext( 100 );
+        sched.enqueue( "b", Folder::Poll, 1.0, 100 );
+        sched.takeNext( 400 );
+
+        QCOMPARE( sched.lastWaitTime(), qint64(300) );
+        QCOMPARE( sched.maxWaitTime(), qint64(300) );
+        QCOMPARE( sched.averageWaitTime(), qint64(200) );
+    }
+};
+
+#endif